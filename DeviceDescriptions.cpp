@@ -0,0 +1,619 @@
+#include "DeviceDescriptions.h"
+
+#include <homegear-base/Encoding/RapidXml/rapidxml.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <map>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+namespace
+{
+
+struct DescriptionFile
+{
+	std::string name;
+	int64_t modificationTime = 0; // Nanoseconds
+	int64_t size = 0;
+	uint64_t hash = 0;
+};
+
+// {{{ Index file layout
+	// All records are written as is, so the index is only valid on machines with the same byte order and alignment.
+	// Bump _indexVersion on every change of the records or of the parsing.
+	const char _indexMagic[4] = { 'H', 'G', 'E', 'I' };
+	const uint32_t _indexVersion = 1;
+
+	struct IndexHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t directory;
+		uint32_t fileCount;
+		uint32_t deviceCount;
+		uint32_t parameterCount;
+		uint32_t conversionCount;
+		uint32_t mapEntryCount;
+		uint32_t stringsSize;
+		uint32_t reserved;
+	};
+
+	struct IndexFile
+	{
+		uint32_t name;
+		uint32_t reserved;
+		int64_t modificationTime;
+		int64_t size;
+		uint64_t hash;
+	};
+
+	struct IndexDevice
+	{
+		uint32_t eep;
+		uint32_t filename;
+		uint32_t firstParameter;
+		uint32_t parameterCount;
+	};
+
+	struct IndexParameter
+	{
+		uint32_t id;
+		int32_t bitOffset;
+		int32_t bitSize;
+		int32_t boolean;
+		uint32_t firstConversion;
+		uint32_t conversionCount;
+	};
+
+	struct IndexConversion
+	{
+		int32_t type;
+		uint32_t typeName;
+		double factor;
+		double offset;
+		int32_t division;
+		int32_t threshold;
+		int32_t trueValue;
+		int32_t falseValue;
+		int32_t invert;
+		uint32_t firstMapEntry;
+		uint32_t mapEntryCount;
+		uint32_t reserved;
+	};
+
+	struct IndexMapEntry
+	{
+		int32_t physical;
+		int32_t logical;
+	};
+
+	static_assert(sizeof(IndexHeader) == 40 && sizeof(IndexFile) == 32 && sizeof(IndexDevice) == 16 && sizeof(IndexParameter) == 24 && sizeof(IndexConversion) == 56 && sizeof(IndexMapEntry) == 8, "Unexpected index record size.");
+// }}}
+
+uint64_t getHash(const std::vector<char>& data)
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for(auto byte : data) hash = (hash ^ (uint8_t)byte) * 1099511628211ull;
+	return hash;
+}
+
+std::vector<char> readFile(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	return std::vector<char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+std::string getNodeValue(rapidxml::xml_node<>* node, const char* name)
+{
+	rapidxml::xml_node<>* child = node ? node->first_node(name) : nullptr;
+	return child ? std::string(child->value(), child->value_size()) : std::string();
+}
+
+std::string getAttributeValue(rapidxml::xml_node<>* node, const char* name)
+{
+	rapidxml::xml_attribute<>* attribute = node ? node->first_attribute(name) : nullptr;
+	return attribute ? std::string(attribute->value(), attribute->value_size()) : std::string();
+}
+
+int64_t toInteger(const std::string& value, int64_t defaultValue)
+{
+	if(value.empty()) return defaultValue;
+	return std::strtoll(value.c_str(), nullptr, 0);
+}
+
+double toDouble(const std::string& value, double defaultValue)
+{
+	if(value.empty()) return defaultValue;
+	return std::strtod(value.c_str(), nullptr);
+}
+
+XmlConversion parseConversion(rapidxml::xml_node<>* node)
+{
+	XmlConversion conversion;
+	conversion.typeName = getAttributeValue(node, "type");
+	if(conversion.typeName == "decimalIntegerScale")
+	{
+		conversion.type = XmlConversion::Type::decimalIntegerScale;
+		conversion.factor = toDouble(getNodeValue(node, "factor"), 10);
+		conversion.offset = toDouble(getNodeValue(node, "offset"), 0);
+	}
+	else if(conversion.typeName == "integerIntegerScale")
+	{
+		conversion.type = XmlConversion::Type::integerIntegerScale;
+		conversion.division = getNodeValue(node, "operation") != "multiplication";
+		conversion.factor = toDouble(getNodeValue(node, "factor"), 10);
+		conversion.offset = toDouble(getNodeValue(node, "offset"), 0);
+	}
+	else if(conversion.typeName == "integerIntegerMap")
+	{
+		conversion.type = XmlConversion::Type::integerIntegerMap;
+		for(rapidxml::xml_node<>* valueNode = node->first_node("value"); valueNode; valueNode = valueNode->next_sibling("value"))
+		{
+			conversion.valueMap.push_back(std::make_pair((int32_t)toInteger(getNodeValue(valueNode, "physical"), 0), (int32_t)toInteger(getNodeValue(valueNode, "logical"), 0)));
+		}
+	}
+	else if(conversion.typeName == "booleanInteger")
+	{
+		conversion.type = XmlConversion::Type::booleanInteger;
+		conversion.threshold = (int32_t)toInteger(getNodeValue(node, "threshold"), -1);
+		conversion.trueValue = (int32_t)toInteger(getNodeValue(node, "trueValue"), 1);
+		conversion.falseValue = (int32_t)toInteger(getNodeValue(node, "falseValue"), 0);
+		conversion.invert = getNodeValue(node, "invert") == "true";
+	}
+	return conversion;
+}
+
+/**
+ * Homegear's EnOcean packets count bits from the most significant bit of the RORG, so the first data bit has index 8.
+ * Old style descriptions use "index" and "size" in the form BYTE.BIT instead.
+ */
+bool parseElementPosition(rapidxml::xml_node<>* element, int32_t& bitOffset, int32_t& bitSize)
+{
+	std::string bitIndex = getNodeValue(element, "bitIndex");
+	if(!bitIndex.empty())
+	{
+		bitOffset = (int32_t)toInteger(bitIndex, 0) - 8;
+		bitSize = (int32_t)toInteger(getNodeValue(element, "bitSize"), 1);
+		return bitOffset >= 0;
+	}
+
+	std::string index = getNodeValue(element, "index");
+	if(index.empty()) return false;
+	double indexValue = toDouble(index, 0);
+	double sizeValue = toDouble(getNodeValue(element, "size"), 1);
+	int32_t byteIndex = (int32_t)indexValue;
+	int32_t bitInByte = (int32_t)std::lround((indexValue - byteIndex) * 10);
+	int32_t bytes = (int32_t)sizeValue;
+	bitSize = bytes * 8 + (int32_t)std::lround((sizeValue - bytes) * 10);
+	bitOffset = (byteIndex - 1) * 8 + (bitSize < 8 ? 8 - bitInByte - bitSize : 0);
+	return bitOffset >= 0;
+}
+
+bool parseDeviceDescription(const std::string& filename, std::vector<char>& buffer, std::vector<XmlDevice>& devices)
+{
+	rapidxml::xml_document<> document;
+	document.parse<rapidxml::parse_no_entity_translation | rapidxml::parse_validate_closing_tags>(buffer.data());
+	rapidxml::xml_node<>* root = document.first_node("homegearDevice");
+	if(!root) return false;
+
+	// {{{ Packet positions
+		std::map<std::string, std::pair<int32_t, int32_t>> positions;
+		rapidxml::xml_node<>* packets = root->first_node("packets");
+		for(rapidxml::xml_node<>* packet = packets ? packets->first_node("packet") : nullptr; packet; packet = packet->next_sibling("packet"))
+		{
+			if(getNodeValue(packet, "direction") == "fromCentral") continue;
+			rapidxml::xml_node<>* payload = packet->first_node("binaryPayload");
+			for(rapidxml::xml_node<>* element = payload ? payload->first_node("element") : nullptr; element; element = element->next_sibling("element"))
+			{
+				std::string parameterId = getNodeValue(element, "parameterId");
+				int32_t bitOffset = -1;
+				int32_t bitSize = 0;
+				if(parameterId.empty() || positions.find(parameterId) != positions.end() || !parseElementPosition(element, bitOffset, bitSize)) continue;
+				positions[parameterId] = std::make_pair(bitOffset, bitSize);
+			}
+		}
+	// }}}
+
+	// {{{ Parameters
+		std::vector<XmlParameter> parameters;
+		rapidxml::xml_node<>* groups = root->first_node("parameterGroups");
+		for(rapidxml::xml_node<>* group = groups ? groups->first_node("variables") : nullptr; group; group = group->next_sibling("variables"))
+		{
+			for(rapidxml::xml_node<>* parameterNode = group->first_node("parameter"); parameterNode; parameterNode = parameterNode->next_sibling("parameter"))
+			{
+				XmlParameter parameter;
+				parameter.id = getAttributeValue(parameterNode, "id");
+				if(parameter.id.empty()) continue;
+				parameter.boolean = parameterNode->first_node("logicalBoolean") != nullptr;
+
+				std::string groupId = parameter.id;
+				for(rapidxml::xml_node<>* child = parameterNode->first_node(); child; child = child->next_sibling())
+				{
+					std::string name(child->name(), child->name_size());
+					if(name.compare(0, 8, "physical") == 0 && !getAttributeValue(child, "groupId").empty()) groupId = getAttributeValue(child, "groupId");
+					else if(name == "conversion") parameter.conversions.push_back(parseConversion(child));
+				}
+
+				auto positionIterator = positions.find(groupId);
+				if(positionIterator != positions.end())
+				{
+					parameter.bitOffset = positionIterator->second.first;
+					parameter.bitSize = positionIterator->second.second;
+				}
+				parameters.push_back(std::move(parameter));
+			}
+		}
+	// }}}
+
+	rapidxml::xml_node<>* supportedDevices = root->first_node("supportedDevices");
+	for(rapidxml::xml_node<>* deviceNode = supportedDevices ? supportedDevices->first_node("device") : nullptr; deviceNode; deviceNode = deviceNode->next_sibling("device"))
+	{
+		std::string typeNumber = getNodeValue(deviceNode, "typeNumber");
+		if(typeNumber.empty()) continue;
+		std::ostringstream eep;
+		eep << std::hex << std::uppercase << std::setw(6) << std::setfill('0') << (toInteger(typeNumber, 0) & 0xFFFFFF);
+		XmlDevice device;
+		device.eep = eep.str();
+		device.filename = filename;
+		device.parameters = parameters;
+		devices.push_back(std::move(device));
+	}
+	return true;
+}
+
+bool getDescriptionFiles(const std::string& directory, std::vector<DescriptionFile>& files)
+{
+	DIR* directoryHandle = opendir(directory.c_str());
+	if(!directoryHandle) return false;
+	for(dirent* entry = readdir(directoryHandle); entry; entry = readdir(directoryHandle))
+	{
+		DescriptionFile file;
+		file.name = std::string(entry->d_name);
+		if(file.name.size() <= 4 || file.name.compare(file.name.size() - 4, 4, ".xml") != 0) continue;
+		struct stat fileInfo;
+		if(stat((directory + '/' + file.name).c_str(), &fileInfo) == -1) continue;
+		file.modificationTime = (int64_t)fileInfo.st_mtim.tv_sec * 1000000000 + fileInfo.st_mtim.tv_nsec;
+		file.size = fileInfo.st_size;
+		files.push_back(std::move(file));
+	}
+	closedir(directoryHandle);
+	std::sort(files.begin(), files.end(), [](const DescriptionFile& a, const DescriptionFile& b) { return a.name < b.name; });
+	return true;
+}
+
+std::vector<XmlDevice> parseDeviceDescriptions(const std::string& directory, std::vector<DescriptionFile>& files)
+{
+	std::vector<XmlDevice> devices;
+	for(auto& file : files)
+	{
+		std::string path = directory + '/' + file.name;
+		std::vector<char> buffer = readFile(path);
+		file.hash = getHash(buffer);
+		buffer.push_back(0);
+		try
+		{
+			if(!parseDeviceDescription(file.name, buffer, devices)) std::cerr << "Skipping " << path << ": No device description." << std::endl;
+		}
+		catch(const rapidxml::parse_error& ex)
+		{
+			std::cerr << "Skipping " << path << ": " << ex.what() << std::endl;
+		}
+	}
+	return devices;
+}
+
+/**
+ * Maps the index and fills devices from it. Returns false if the index doesn't exist, is corrupt or belongs to other
+ * files. Files with changed modification times are hashed, if their content didn't change either the index is still
+ * used and outdated is set so the caller can rewrite it with the new times.
+ */
+bool readIndex(const std::string& indexFilename, const std::string& directory, std::vector<DescriptionFile>& files, std::vector<XmlDevice>& devices, bool& outdated)
+{
+	int fileDescriptor = open(indexFilename.c_str(), O_RDONLY);
+	if(fileDescriptor == -1) return false;
+	struct stat indexInfo;
+	if(fstat(fileDescriptor, &indexInfo) == -1 || (size_t)indexInfo.st_size < sizeof(IndexHeader))
+	{
+		close(fileDescriptor);
+		return false;
+	}
+	size_t size = indexInfo.st_size;
+	void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	close(fileDescriptor);
+	if(mapping == MAP_FAILED) return false;
+
+	const char* data = (const char*)mapping;
+	const IndexHeader* header = (const IndexHeader*)data;
+	const IndexFile* indexFiles = (const IndexFile*)(data + sizeof(IndexHeader));
+	const IndexDevice* indexDevices = (const IndexDevice*)(indexFiles + header->fileCount);
+	const IndexParameter* indexParameters = (const IndexParameter*)(indexDevices + header->deviceCount);
+	const IndexConversion* indexConversions = (const IndexConversion*)(indexParameters + header->parameterCount);
+	const IndexMapEntry* indexMapEntries = (const IndexMapEntry*)(indexConversions + header->conversionCount);
+	const char* strings = (const char*)(indexMapEntries + header->mapEntryCount);
+
+	auto getString = [&](uint32_t offset) { return offset < header->stringsSize ? std::string(strings + offset) : std::string(); };
+
+	bool valid = std::memcmp(header->magic, _indexMagic, sizeof(_indexMagic)) == 0 && header->version == _indexVersion &&
+		sizeof(IndexHeader) + (size_t)header->fileCount * sizeof(IndexFile) + (size_t)header->deviceCount * sizeof(IndexDevice) +
+		(size_t)header->parameterCount * sizeof(IndexParameter) + (size_t)header->conversionCount * sizeof(IndexConversion) +
+		(size_t)header->mapEntryCount * sizeof(IndexMapEntry) + header->stringsSize == size &&
+		header->stringsSize > 0 && strings[header->stringsSize - 1] == 0 &&
+		getString(header->directory) == directory && header->fileCount == files.size();
+
+	for(uint32_t i = 0; valid && i < header->fileCount; i++)
+	{
+		const IndexFile& indexFile = indexFiles[i];
+		DescriptionFile& file = files[i];
+		if(getString(indexFile.name) != file.name || indexFile.size != file.size) valid = false;
+		else if(indexFile.modificationTime != file.modificationTime)
+		{
+			if(getHash(readFile(directory + '/' + file.name)) != indexFile.hash) valid = false;
+			else outdated = true;
+		}
+		file.hash = indexFile.hash;
+	}
+
+	for(uint32_t i = 0; valid && i < header->deviceCount; i++)
+	{
+		const IndexDevice& indexDevice = indexDevices[i];
+		if((uint64_t)indexDevice.firstParameter + indexDevice.parameterCount > header->parameterCount)
+		{
+			valid = false;
+			break;
+		}
+		XmlDevice device;
+		device.eep = getString(indexDevice.eep);
+		device.filename = getString(indexDevice.filename);
+		device.parameters.reserve(indexDevice.parameterCount);
+		for(uint32_t j = indexDevice.firstParameter; valid && j < indexDevice.firstParameter + indexDevice.parameterCount; j++)
+		{
+			const IndexParameter& indexParameter = indexParameters[j];
+			if((uint64_t)indexParameter.firstConversion + indexParameter.conversionCount > header->conversionCount)
+			{
+				valid = false;
+				break;
+			}
+			XmlParameter parameter;
+			parameter.id = getString(indexParameter.id);
+			parameter.bitOffset = indexParameter.bitOffset;
+			parameter.bitSize = indexParameter.bitSize;
+			parameter.boolean = indexParameter.boolean != 0;
+			for(uint32_t k = indexParameter.firstConversion; k < indexParameter.firstConversion + indexParameter.conversionCount; k++)
+			{
+				const IndexConversion& indexConversion = indexConversions[k];
+				if((uint64_t)indexConversion.firstMapEntry + indexConversion.mapEntryCount > header->mapEntryCount)
+				{
+					valid = false;
+					break;
+				}
+				XmlConversion conversion;
+				conversion.type = (XmlConversion::Type)indexConversion.type;
+				conversion.typeName = getString(indexConversion.typeName);
+				conversion.factor = indexConversion.factor;
+				conversion.offset = indexConversion.offset;
+				conversion.division = indexConversion.division != 0;
+				conversion.threshold = indexConversion.threshold;
+				conversion.trueValue = indexConversion.trueValue;
+				conversion.falseValue = indexConversion.falseValue;
+				conversion.invert = indexConversion.invert != 0;
+				for(uint32_t l = indexConversion.firstMapEntry; l < indexConversion.firstMapEntry + indexConversion.mapEntryCount; l++)
+				{
+					conversion.valueMap.push_back(std::make_pair(indexMapEntries[l].physical, indexMapEntries[l].logical));
+				}
+				parameter.conversions.push_back(std::move(conversion));
+			}
+			device.parameters.push_back(std::move(parameter));
+		}
+		devices.push_back(std::move(device));
+	}
+
+	munmap(mapping, size);
+	if(!valid) devices.clear();
+	return valid;
+}
+
+bool writeIndex(const std::string& indexFilename, const std::string& directory, const std::vector<DescriptionFile>& files, const std::vector<XmlDevice>& devices)
+{
+	IndexHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::vector<IndexFile> indexFiles;
+	std::vector<IndexDevice> indexDevices;
+	std::vector<IndexParameter> indexParameters;
+	std::vector<IndexConversion> indexConversions;
+	std::vector<IndexMapEntry> indexMapEntries;
+	std::string strings;
+	std::unordered_map<std::string, uint32_t> stringOffsets;
+
+	auto addString = [&](const std::string& value)
+	{
+		auto stringIterator = stringOffsets.find(value);
+		if(stringIterator != stringOffsets.end()) return stringIterator->second;
+		uint32_t offset = strings.size();
+		strings.append(value);
+		strings.push_back(0);
+		stringOffsets.emplace(value, offset);
+		return offset;
+	};
+
+	for(auto& file : files)
+	{
+		IndexFile indexFile;
+		std::memset(&indexFile, 0, sizeof(indexFile));
+		indexFile.name = addString(file.name);
+		indexFile.modificationTime = file.modificationTime;
+		indexFile.size = file.size;
+		indexFile.hash = file.hash;
+		indexFiles.push_back(indexFile);
+	}
+
+	for(auto& device : devices)
+	{
+		IndexDevice indexDevice{ addString(device.eep), addString(device.filename), (uint32_t)indexParameters.size(), (uint32_t)device.parameters.size() };
+		indexDevices.push_back(indexDevice);
+		for(auto& parameter : device.parameters)
+		{
+			IndexParameter indexParameter{ addString(parameter.id), parameter.bitOffset, parameter.bitSize, parameter.boolean, (uint32_t)indexConversions.size(), (uint32_t)parameter.conversions.size() };
+			indexParameters.push_back(indexParameter);
+			for(auto& conversion : parameter.conversions)
+			{
+				IndexConversion indexConversion;
+				std::memset(&indexConversion, 0, sizeof(indexConversion));
+				indexConversion.type = (int32_t)conversion.type;
+				indexConversion.typeName = addString(conversion.typeName);
+				indexConversion.factor = conversion.factor;
+				indexConversion.offset = conversion.offset;
+				indexConversion.division = conversion.division;
+				indexConversion.threshold = conversion.threshold;
+				indexConversion.trueValue = conversion.trueValue;
+				indexConversion.falseValue = conversion.falseValue;
+				indexConversion.invert = conversion.invert;
+				indexConversion.firstMapEntry = indexMapEntries.size();
+				indexConversion.mapEntryCount = conversion.valueMap.size();
+				indexConversions.push_back(indexConversion);
+				for(auto& entry : conversion.valueMap) indexMapEntries.push_back(IndexMapEntry{ entry.first, entry.second });
+			}
+		}
+	}
+
+	std::memcpy(header.magic, _indexMagic, sizeof(_indexMagic));
+	header.version = _indexVersion;
+	header.directory = addString(directory);
+	header.fileCount = indexFiles.size();
+	header.deviceCount = indexDevices.size();
+	header.parameterCount = indexParameters.size();
+	header.conversionCount = indexConversions.size();
+	header.mapEntryCount = indexMapEntries.size();
+	header.stringsSize = strings.size();
+
+	// Write to a temporary file first, so concurrent runs never map a half written index.
+	std::string temporaryFilename = indexFilename + "." + std::to_string(getpid());
+	{
+		std::ofstream file(temporaryFilename, std::ios::binary | std::ios::trunc);
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)indexFiles.data(), indexFiles.size() * sizeof(IndexFile));
+		file.write((const char*)indexDevices.data(), indexDevices.size() * sizeof(IndexDevice));
+		file.write((const char*)indexParameters.data(), indexParameters.size() * sizeof(IndexParameter));
+		file.write((const char*)indexConversions.data(), indexConversions.size() * sizeof(IndexConversion));
+		file.write((const char*)indexMapEntries.data(), indexMapEntries.size() * sizeof(IndexMapEntry));
+		file.write(strings.data(), strings.size());
+		if(!file.good())
+		{
+			file.close();
+			unlink(temporaryFilename.c_str());
+			return false;
+		}
+	}
+	if(rename(temporaryFilename.c_str(), indexFilename.c_str()) == -1)
+	{
+		unlink(temporaryFilename.c_str());
+		return false;
+	}
+	return true;
+}
+
+}
+
+const XmlParameter* XmlDevice::getParameter(const std::string& id) const
+{
+	for(auto& parameter : parameters)
+	{
+		if(parameter.id == id) return &parameter;
+	}
+	return nullptr;
+}
+
+
+std::vector<XmlDevice> loadDeviceDescriptions(const std::string& directory, const std::string& indexFilename)
+{
+	std::vector<DescriptionFile> files;
+	if(!getDescriptionFiles(directory, files))
+	{
+		std::cerr << "Could not open directory " << directory << "." << std::endl;
+		return std::vector<XmlDevice>();
+	}
+
+	std::vector<XmlDevice> devices;
+	bool outdated = false;
+	if(!indexFilename.empty() && readIndex(indexFilename, directory, files, devices, outdated))
+	{
+		if(outdated) writeIndex(indexFilename, directory, files, devices);
+		return devices;
+	}
+
+	devices = parseDeviceDescriptions(directory, files);
+	if(!indexFilename.empty() && !writeIndex(indexFilename, directory, files, devices)) std::cerr << "Could not write EEP index " << indexFilename << "." << std::endl;
+	return devices;
+}
+
+bool convertFromPacket(const XmlParameter& parameter, const std::vector<int32_t>& raw, std::vector<double>& values)
+{
+	size_t size = raw.size();
+	values.resize(size);
+	double* value = values.data();
+	for(size_t i = 0; i < size; i++) value[i] = raw[i];
+
+	for(auto conversion = parameter.conversions.rbegin(); conversion != parameter.conversions.rend(); ++conversion)
+	{
+		switch(conversion->type)
+		{
+			case XmlConversion::Type::decimalIntegerScale:
+			{
+				double factor = conversion->factor;
+				double offset = conversion->offset;
+				for(size_t i = 0; i < size; i++) value[i] = value[i] / factor - offset;
+				break;
+			}
+			case XmlConversion::Type::integerIntegerScale:
+			{
+				double factor = conversion->division ? conversion->factor : 1.0 / conversion->factor;
+				double offset = conversion->offset;
+				for(size_t i = 0; i < size; i++) value[i] = std::round((value[i] - offset) * factor);
+				break;
+			}
+			case XmlConversion::Type::integerIntegerMap:
+			{
+				for(size_t i = 0; i < size; i++)
+				{
+					for(auto& entry : conversion->valueMap)
+					{
+						if(value[i] == entry.first)
+						{
+							value[i] = entry.second;
+							break;
+						}
+					}
+				}
+				break;
+			}
+			case XmlConversion::Type::booleanInteger:
+			{
+				double threshold = conversion->threshold;
+				double trueValue = conversion->trueValue;
+				double invert = conversion->invert ? 1 : 0;
+				if(conversion->threshold >= 0) for(size_t i = 0; i < size; i++) value[i] = std::abs((value[i] >= threshold ? 1 : 0) - invert);
+				else for(size_t i = 0; i < size; i++) value[i] = std::abs((value[i] == trueValue ? 1 : 0) - invert);
+				break;
+			}
+			default:
+				return false;
+		}
+	}
+
+	if(parameter.boolean && parameter.conversions.empty())
+	{
+		for(size_t i = 0; i < size; i++) value[i] = value[i] != 0 ? 1 : 0;
+	}
+	return true;
+}
@@ -0,0 +1,68 @@
+#ifndef DEVICEDESCRIPTIONS_H_
+#define DEVICEDESCRIPTIONS_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * One entry of a parameter's conversion chain in Homegear's device descriptions. Only the members used by the
+ * respective type are set.
+ */
+struct XmlConversion
+{
+	enum class Type : int32_t { unsupported, decimalIntegerScale, integerIntegerScale, integerIntegerMap, booleanInteger };
+
+	Type type = Type::unsupported;
+	std::string typeName;
+	double factor = 10;
+	double offset = 0;
+	bool division = true;
+	int32_t threshold = -1;
+	int32_t trueValue = 1;
+	int32_t falseValue = 0;
+	bool invert = false;
+	std::vector<std::pair<int32_t, int32_t>> valueMap; // physical, logical
+};
+
+/**
+ * A variable of a device description together with its position in the packet received from the device. Bit
+ * positions are relative to the first data byte after the RORG and use the EEP numbering (bit 0 is the most significant
+ * bit), so they can be compared with EepField directly.
+ */
+struct XmlParameter
+{
+	std::string id;
+	int32_t bitOffset = -1;
+	int32_t bitSize = 0;
+	bool boolean = false;
+	std::vector<XmlConversion> conversions; // In the order of the description, i. e. from logical to physical
+};
+
+struct XmlDevice
+{
+	std::string eep;
+	std::string filename;
+	std::vector<XmlParameter> parameters;
+
+	const XmlParameter* getParameter(const std::string& id) const;
+};
+
+/**
+ * Parses all device descriptions in directory (usually "/etc/homegear/devices/15"). Files that cannot be parsed are
+ * reported on stderr and skipped.
+ *
+ * When indexFilename is not empty, the parsed descriptions are stored there in a binary index. Later calls map the
+ * index instead of parsing the XML files again as long as no file was added, removed or changed. Changes are detected
+ * by size and modification time, files only touched are recognized by their hash.
+ */
+std::vector<XmlDevice> loadDeviceDescriptions(const std::string& directory, const std::string& indexFilename);
+
+/**
+ * Converts raw packet values to logical values the same way Homegear does on reception. The conversion chain is
+ * applied backwards, one conversion at a time over the whole batch, so the inner loops are simple enough for the
+ * compiler to vectorize. Returns false if the chain contains a conversion type that is not supported.
+ */
+bool convertFromPacket(const XmlParameter& parameter, const std::vector<int32_t>& raw, std::vector<double>& values);
+
+#endif
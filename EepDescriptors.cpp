@@ -0,0 +1,308 @@
+#include "EepDescriptors.h"
+
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <set>
+
+namespace
+{
+
+EepDescriptor getA502Descriptor(std::string eep, int32_t maxIndex, double maxTemperature, double factor)
+{
+	std::ostringstream description;
+	description << "Values should go from " << std::fixed << std::setprecision(1) << (maxTemperature - ((double)maxIndex / factor)) << "°C to " << maxTemperature << "°C...";
+	int32_t bitSize = maxIndex > 255 ? 10 : 8;
+	return EepDescriptor{ eep, 0xA5, description.str(),
+		{ { "TEMPERATURE", 24 - bitSize, bitSize, 0, maxIndex, maxTemperature, -factor, 0, -1 } },
+		{ { { 0, 0, 0, 0x08 }, maxIndex, {}, {} } },
+		{} };
+}
+
+/**
+ * Pass over the boundary values and three interior values of every field, combined in a covering array of the given
+ * strength.
+ */
+EepPass getCoveringPass(std::vector<uint8_t> data, const std::vector<EepField>& fields, int32_t strength)
+{
+	std::vector<std::vector<int32_t>> levels;
+	for(auto& field : fields) levels.push_back(getFieldLevels(field, 3));
+	std::vector<std::vector<int32_t>> rows = getCoveringArray(levels, strength);
+	return EepPass{ data, (int32_t)rows.size() - 1, {}, rows };
+}
+
+EepDescriptor getD232Descriptor(std::string eep, int32_t channels)
+{
+	std::vector<EepField> fields{ { "POWER_FAIL", 0, 1, 0, 1, 0, 1, 0, 1 } };
+	for(int32_t i = 0; i < channels; i++) fields.push_back(EepField{ "CURRENT_" + std::to_string(i + 1), 8 + i * 12, 12, 0, 4095, 0, 1, 0, -1 });
+	std::vector<uint8_t> data((8 + channels * 12 + 7) / 8, 0); // Divisor bit cleared: Currents in A
+	return EepDescriptor{ eep, 0xD2, "Pairwise combinations of power fail and 0 A to 4095 A per channel...", fields, { getCoveringPass(data, fields, 2) }, {} };
+}
+
+std::vector<EepDescriptor> createEepDescriptors()
+{
+	return std::vector<EepDescriptor>
+	{
+		getA502Descriptor("A50201", 255, 0, 6.375),
+		getA502Descriptor("A50202", 255, 10, 6.375),
+		getA502Descriptor("A50203", 255, 20, 6.375),
+		getA502Descriptor("A50204", 255, 30, 6.375),
+		getA502Descriptor("A50205", 255, 40, 6.375),
+		getA502Descriptor("A50206", 255, 50, 6.375),
+		getA502Descriptor("A50207", 255, 60, 6.375),
+		getA502Descriptor("A50208", 255, 70, 6.375),
+		getA502Descriptor("A50209", 255, 80, 6.375),
+		getA502Descriptor("A5020A", 255, 90, 6.375),
+		getA502Descriptor("A5020B", 255, 100, 6.375),
+		getA502Descriptor("A50210", 255, 20, 3.1875),
+		getA502Descriptor("A50211", 255, 30, 3.1875),
+		getA502Descriptor("A50212", 255, 40, 3.1875),
+		getA502Descriptor("A50213", 255, 50, 3.1875),
+		getA502Descriptor("A50214", 255, 60, 3.1875),
+		getA502Descriptor("A50215", 255, 70, 3.1875),
+		getA502Descriptor("A50216", 255, 80, 3.1875),
+		getA502Descriptor("A50217", 255, 90, 3.1875),
+		getA502Descriptor("A50218", 255, 100, 3.1875),
+		getA502Descriptor("A50219", 255, 110, 3.1875),
+		getA502Descriptor("A5021A", 255, 120, 3.1875),
+		getA502Descriptor("A5021B", 255, 130, 3.1875),
+		getA502Descriptor("A50220", 1023, 41.2, 20),
+		getA502Descriptor("A50230", 1023, 62.3, 10),
+		// Variable, bit offset, bit size, raw min, raw max, value at raw 0, factor, tolerance, boolean threshold
+		EepDescriptor{ "A50401", 0xA5, "Values should go from 0% to 100% and from 0°C to 40°C...",
+			{
+				{ "TEMPERATURE", 16, 8, 0, 250, 0, 6.25, 0, -1 },
+				{ "HUMIDITY", 8, 8, 0, 250, 0, 2.5, 0, -1 }
+			},
+			{ { { 0, 0, 0, 0x0A }, 250, {}, {} } },
+			{ { { { 0, 0, 0, 0x0A }, { 0, 0xFA, 0xFA, 0x08 } }, { 0, 100 } } } }, // Temperature data available?
+		EepDescriptor{ "A50402", 0xA5, "Values should go from 0% to 100% and from -20°C to 60°C...",
+			{
+				{ "TEMPERATURE", 16, 8, 0, 250, -20, 3.125, 0, -1 },
+				{ "HUMIDITY", 8, 8, 0, 250, 0, 2.5, 0, -1 }
+			},
+			{ { { 0, 0, 0, 0x0A }, 250, {}, {} } },
+			{ { { { 0, 0, 0, 0x0A }, { 0, 0xFA, 0xFA, 0x08 } }, { -20, 100 } } } }, // Temperature data available?
+		EepDescriptor{ "A50403", 0xA5, "Values should go from 0% to 100% and from -20°C to 60°C...",
+			{
+				{ "TEMPERATURE", 14, 10, 0, 1023, -20, 12.7875, 1, -1 },
+				{ "HUMIDITY", 0, 8, 0, 255, 0, 2.55, 0, -1 }
+			},
+			{ { { 0, 0, 0, 0x0A }, 1023, {}, {} } },
+			{} },
+		EepDescriptor{ "A50501", 0xA5, "Values should go from 500 hPa to 1150 hPa...",
+			{ { "PRESSURE", 6, 10, 0, 1023, 500, 1.573846, 1, -1 } },
+			{ { { 0, 0, 0, 0x08 }, 1023, {}, {} } },
+			{} },
+		EepDescriptor{ "A50601", 0xA5, "Values should go from 300 lx to 30000 lx for ILLUMINATION2 and from 600 lx to 60000 lx for ILLUMINATION1...",
+			{
+				{ "SUPPLY_VOLTAGE", 0, 8, 0, 255, 0, 50.0, 0, -1 },
+				{ "ILLUMINATION_1", 16, 8, 0, 255, 600, 0.0042929293, 1, -1 },
+				{ "ILLUMINATION_2", 8, 8, 0, 255, 300, 0.0085858585, 1, -1 }
+			},
+			{
+				{ { 0, 0, 0, 0x08 }, 255, { "ILLUMINATION_2" }, {} },
+				{ { 0, 0, 0, 0x09 }, 255, { "ILLUMINATION_1" }, {} }
+			},
+			{} },
+		EepDescriptor{ "A50602", 0xA5, "Values should go from 0 lx to 510 lx for ILLUMINATION2 and from 0 lx to 1020 lx for ILLUMINATION1...",
+			{
+				{ "SUPPLY_VOLTAGE", 0, 8, 0, 255, 0, 50.0, 0, -1 },
+				{ "ILLUMINATION_1", 16, 8, 0, 255, 0, 0.25, 1, -1 },
+				{ "ILLUMINATION_2", 8, 8, 0, 255, 0, 0.5, 1, -1 }
+			},
+			{
+				{ { 0, 0, 0, 0x08 }, 255, { "ILLUMINATION_2" }, {} },
+				{ { 0, 0, 0, 0x09 }, 255, { "ILLUMINATION_1" }, {} }
+			},
+			{} },
+		EepDescriptor{ "A50603", 0xA5, "Values should go from 0 lx to 1000 lx...",
+			{
+				{ "SUPPLY_VOLTAGE", 0, 8, 0, 250, 0, 50.0, 0, -1 },
+				{ "ILLUMINATION", 8, 10, 0, 1000, 0, 1, 0, -1 }
+			},
+			{ { { 0, 0, 0, 0x08 }, 1000, {}, {} } },
+			{} },
+		EepDescriptor{ "A50604", 0xA5, "Values should go from 0 lx to 65535 lx and -20 °C to 60 °C...",
+			{
+				{ "TEMPERATURE", 0, 8, 0, 255, -20, 3.125, 0, -1 },
+				{ "ILLUMINATION", 8, 16, 0, 65535, 0, 1, 0, -1 },
+				{ "ENERGY_STORAGE", 24, 4, 0, 15, 0, 0.15, 0, -1 }
+			},
+			{ { { 0, 0, 0, 0x0B }, 1023, {}, {} } },
+			{} },
+		EepDescriptor{ "A50605", 0xA5, "Values should go from 0 lx to 5100 lx for ILLUMINATION2 and from 0 lx to 10200 lx for ILLUMINATION1...",
+			{
+				{ "SUPPLY_VOLTAGE", 0, 8, 0, 255, 0, 50.0, 0, -1 },
+				{ "ILLUMINATION_1", 16, 8, 0, 255, 0, 0.025, 1, -1 },
+				{ "ILLUMINATION_2", 8, 8, 0, 255, 0, 0.05, 1, -1 }
+			},
+			{
+				{ { 0, 0, 0, 0x08 }, 255, { "ILLUMINATION_2" }, {} },
+				{ { 0, 0, 0, 0x09 }, 255, { "ILLUMINATION_1" }, {} }
+			},
+			{} },
+		EepDescriptor{ "A50701", 0xA5, "Values should go from 0 V to 5 V, motion from raw 128 on...",
+			{
+				{ "SUPPLY_VOLTAGE", 0, 8, 0, 250, 0, 50.0, 0, -1 },
+				{ "MOTION", 16, 8, 0, 255, 0, 1, 0, 128 }
+			},
+			{ { { 0, 0, 0, 0x09 }, 255, {}, {} } },
+			{} },
+		getD232Descriptor("D23200", 1),
+		getD232Descriptor("D23201", 2),
+		getD232Descriptor("D23202", 3),
+		EepDescriptor{ "D50001", 0xD5, "Contact should be open and closed...",
+			{ { "STATE", 7, 1, 0, 1, 0, 1, 0, 1 } },
+			{ getCoveringPass({ 0x08 }, { { "STATE", 7, 1, 0, 1, 0, 1, 0, 1 } }, 1) },
+			{} }
+	};
+}
+
+}
+
+std::vector<int32_t> getFieldLevels(const EepField& field, int32_t interiorValues)
+{
+	std::set<int32_t> levels{ field.rawMin, field.rawMin + 1, field.rawMax - 1, field.rawMax };
+	if(field.threshold >= 0)
+	{
+		levels.insert(field.threshold - 1);
+		levels.insert(field.threshold);
+	}
+	for(int32_t i = 1; i <= interiorValues; i++) levels.insert(field.rawMin + (int32_t)((int64_t)(field.rawMax - field.rawMin) * i / (interiorValues + 1)));
+
+	std::vector<int32_t> result;
+	for(int32_t level : levels)
+	{
+		if(level >= field.rawMin && level <= field.rawMax) result.push_back(level);
+	}
+	return result;
+}
+
+std::vector<std::vector<int32_t>> getCoveringArray(const std::vector<std::vector<int32_t>>& levels, int32_t strength)
+{
+	// Row entries are level indexes, -1 while not chosen yet
+	struct Combination
+	{
+		std::vector<size_t> parameters;
+		std::vector<bool> covered; // By tuple index, the first parameter is the most significant digit
+	};
+
+	std::vector<std::vector<int32_t>> rows;
+	if(levels.empty()) return rows;
+	for(auto& parameterLevels : levels)
+	{
+		if(parameterLevels.empty()) return rows;
+	}
+	size_t parameterCount = levels.size();
+	size_t combinationSize = std::max((size_t)1, std::min((size_t)std::max(strength, 1), parameterCount));
+
+	// {{{ All sets of combinationSize parameters
+		std::vector<Combination> combinations;
+		int64_t uncovered = 0;
+		std::vector<size_t> parameters(combinationSize);
+		for(size_t i = 0; i < combinationSize; i++) parameters[i] = i;
+		while(true)
+		{
+			size_t tupleCount = 1;
+			for(size_t parameter : parameters) tupleCount *= levels[parameter].size();
+			combinations.push_back(Combination{ parameters, std::vector<bool>(tupleCount, false) });
+			uncovered += tupleCount;
+
+			int32_t i = (int32_t)combinationSize - 1;
+			while(i >= 0 && parameters[i] == parameterCount - combinationSize + i) i--;
+			if(i < 0) break;
+			parameters[i]++;
+			for(size_t j = i + 1; j < combinationSize; j++) parameters[j] = parameters[j - 1] + 1;
+		}
+	// }}}
+
+	auto getTuple = [&](const Combination& combination, size_t tupleIndex)
+	{
+		std::vector<int32_t> tuple(combination.parameters.size());
+		for(size_t i = combination.parameters.size(); i-- > 0;)
+		{
+			tuple[i] = tupleIndex % levels[combination.parameters[i]].size();
+			tupleIndex /= levels[combination.parameters[i]].size();
+		}
+		return tuple;
+	};
+
+	// Number of missing tuples of the combinations containing parameter which still fit the partially chosen row
+	auto getGain = [&](const std::vector<int32_t>& row, size_t parameter)
+	{
+		int64_t gain = 0;
+		for(auto& combination : combinations)
+		{
+			if(std::find(combination.parameters.begin(), combination.parameters.end(), parameter) == combination.parameters.end()) continue;
+			for(size_t tupleIndex = 0; tupleIndex < combination.covered.size(); tupleIndex++)
+			{
+				if(combination.covered[tupleIndex]) continue;
+				std::vector<int32_t> tuple = getTuple(combination, tupleIndex);
+				bool fits = true;
+				for(size_t i = 0; i < tuple.size() && fits; i++) fits = row[combination.parameters[i]] == -1 || row[combination.parameters[i]] == tuple[i];
+				if(fits) gain++;
+			}
+		}
+		return gain;
+	};
+
+	while(uncovered > 0)
+	{
+		std::vector<int32_t> row(parameterCount, -1);
+		for(auto& combination : combinations)
+		{
+			auto missing = std::find(combination.covered.begin(), combination.covered.end(), false);
+			if(missing == combination.covered.end()) continue;
+			std::vector<int32_t> tuple = getTuple(combination, missing - combination.covered.begin());
+			for(size_t i = 0; i < tuple.size(); i++) row[combination.parameters[i]] = tuple[i];
+			break;
+		}
+
+		for(size_t parameter = 0; parameter < parameterCount; parameter++)
+		{
+			if(row[parameter] != -1) continue;
+			int32_t bestLevel = 0;
+			int64_t bestGain = -1;
+			for(size_t level = 0; level < levels[parameter].size(); level++)
+			{
+				row[parameter] = level;
+				int64_t gain = getGain(row, parameter);
+				if(gain > bestGain)
+				{
+					bestGain = gain;
+					bestLevel = level;
+				}
+			}
+			row[parameter] = bestLevel;
+		}
+
+		std::vector<int32_t> values(parameterCount);
+		for(size_t parameter = 0; parameter < parameterCount; parameter++) values[parameter] = levels[parameter][row[parameter]];
+		for(auto& combination : combinations)
+		{
+			size_t tupleIndex = 0;
+			for(size_t parameter : combination.parameters) tupleIndex = tupleIndex * levels[parameter].size() + row[parameter];
+			if(combination.covered[tupleIndex]) continue;
+			combination.covered[tupleIndex] = true;
+			uncovered--;
+		}
+		rows.push_back(values);
+	}
+	return rows;
+}
+
+const std::vector<EepDescriptor>& getEepDescriptors()
+{
+	static const std::vector<EepDescriptor> descriptors = createEepDescriptors();
+	return descriptors;
+}
+
+const EepDescriptor* findEepDescriptor(const std::string& eep)
+{
+	for(auto& descriptor : getEepDescriptors())
+	{
+		if(descriptor.eep == eep) return &descriptor;
+	}
+	return nullptr;
+}
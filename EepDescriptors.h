@@ -0,0 +1,121 @@
+#ifndef EEPDESCRIPTORS_H_
+#define EEPDESCRIPTORS_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+/**
+ * One value of an EEP. Bit positions follow the EEP specification: Bit 0 is the most significant bit of the first data
+ * byte after the RORG.
+ */
+struct EepField
+{
+	std::string variable; // Homegear variable on channel 1
+	int32_t bitOffset;
+	int32_t bitSize;
+	int32_t rawMin;
+	int32_t rawMax;
+	double base; // Value at raw 0
+	double factor; // Raw units per value unit: raw = lround((value - base) * factor)
+	int32_t tolerance; // Accepted deviation in raw units
+	int32_t threshold; // Boolean fields are true from this raw value on, -1 for numeric fields
+};
+
+/**
+ * One sweep over all fields. The fields walk their raw range proportionally to the step, so fields smaller than the
+ * number of steps see every raw value. Inactive fields are still encoded but expected to read back as raw 0 (e.g.
+ * the illumination not selected by the range select bit of A5-06-01).
+ *
+ * Profiles with several independent fields can't be swept like this without missing most combinations. Their passes
+ * list the raw values of every step in rows instead, see getCoveringArray().
+ */
+struct EepPass
+{
+	std::vector<uint8_t> data; // Data bytes with flags and LRN bit, fields are OR'ed in
+	int32_t steps;
+	std::vector<std::string> inactive;
+	std::vector<std::vector<int32_t>> rows; // When not empty, the raw value of each field for steps 0 to steps
+};
+
+/**
+ * Frames sent in order to the teached-in peer, after which the fields must read back as expectedValues.
+ */
+struct EepCheck
+{
+	std::vector<std::vector<uint8_t>> frames;
+	std::vector<double> expectedValues;
+};
+
+struct EepDescriptor
+{
+	std::string eep;
+	uint8_t rorg;
+	std::string description;
+	std::vector<EepField> fields;
+	std::vector<EepPass> passes;
+	std::vector<EepCheck> checks;
+};
+
+const std::vector<EepDescriptor>& getEepDescriptors();
+const EepDescriptor* findEepDescriptor(const std::string& eep);
+
+inline void setBits(std::vector<uint8_t>& data, int32_t bitOffset, int32_t bitSize, uint32_t value)
+{
+	for(int32_t i = 0; i < bitSize; i++)
+	{
+		int32_t bit = bitOffset + bitSize - 1 - i;
+		if(value & (1u << i)) data.at(bit / 8) |= (uint8_t)(0x80 >> (bit % 8));
+		else data.at(bit / 8) &= (uint8_t)~(0x80 >> (bit % 8));
+	}
+}
+
+inline uint32_t getBits(const std::vector<uint8_t>& data, int32_t bitOffset, int32_t bitSize)
+{
+	uint32_t value = 0;
+	for(int32_t bit = bitOffset; bit < bitOffset + bitSize; bit++)
+	{
+		value = (value << 1) | ((data.at(bit / 8) >> (7 - (bit % 8))) & 1);
+	}
+	return value;
+}
+
+inline int32_t getStepRaw(const EepField& field, int32_t step, int32_t steps)
+{
+	if(steps <= 0) return field.rawMin;
+	return field.rawMin + (int32_t)(((int64_t)step * (field.rawMax - field.rawMin) + steps / 2) / steps);
+}
+
+inline int32_t getStepRaw(const EepPass& pass, size_t fieldIndex, const EepField& field, int32_t step)
+{
+	return pass.rows.empty() ? getStepRaw(field, step, pass.steps) : pass.rows.at(step).at(fieldIndex);
+}
+
+/**
+ * Raw values of a field worth testing: both ends of the range and their neighbours, both sides of the threshold of
+ * boolean fields and interiorValues evenly spaced values in between.
+ */
+std::vector<int32_t> getFieldLevels(const EepField& field, int32_t interiorValues);
+
+/**
+ * Builds a covering array of the given strength: Rows of one value per parameter, chosen from levels, so that for
+ * every set of "strength" parameters every combination of their values appears in at least one row. The rows are built
+ * greedily one at a time, each starting with a combination not covered yet and completed with the values covering the
+ * most other missing combinations. This needs far fewer rows than all combinations, e. g. 58 instead of 686 for
+ * pairwise coverage of four fields with 2, 7, 7 and 7 levels.
+ */
+std::vector<std::vector<int32_t>> getCoveringArray(const std::vector<std::vector<int32_t>>& levels, int32_t strength);
+
+inline double getFieldValue(const EepField& field, int32_t raw)
+{
+	if(field.threshold >= 0) return raw >= field.threshold ? 1 : 0;
+	return field.base + raw / field.factor;
+}
+
+inline int32_t getFieldRaw(const EepField& field, double value)
+{
+	return std::lround((value - field.base) * field.factor);
+}
+
+#endif
@@ -0,0 +1,212 @@
+#include "Metrics.h"
+
+#include <iostream>
+#include <deque>
+#include <algorithm>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace
+{
+
+const char _magic[8] = { 'H', 'G', 'E', 'O', 'M', 'T', 'R', 'C' };
+
+std::mutex _metricsMutex;
+MetricsFile* _file = nullptr;
+bool _enabled = false;
+bool _added = false;
+std::deque<MetricSlot> _memorySlots; // Without a file or when it is full, not limited by metricsCapacity
+std::deque<MetricsHistogram> _histograms; // Deques keep the references returned by addHistogram() and addText() valid
+std::deque<MetricsText> _texts;
+
+void copyString(char* target, size_t size, const std::string& value)
+{
+	size_t length = std::min(value.size(), size - 1);
+	std::memcpy(target, value.data(), length);
+	target[length] = 0;
+}
+
+MetricSlot& addSlot(const std::string& name, const std::string& help, MetricType type)
+{
+	std::lock_guard<std::mutex> metricsGuard(_metricsMutex);
+	_added = true;
+	uint32_t index = _file ? _file->count.load(std::memory_order_relaxed) : 0;
+	if(_file && index >= metricsCapacity && _memorySlots.empty()) std::cerr << "Warning: Metrics file is full. Further metrics are not published." << std::endl;
+	bool inFile = _file && index < metricsCapacity;
+	if(!inFile) _memorySlots.emplace_back(); // Value-initialized, so zero like a new file
+	MetricSlot& slot = inFile ? _file->slots[index] : _memorySlots.back();
+	copyString(slot.name, sizeof(slot.name), name);
+	copyString(slot.help, sizeof(slot.help), help);
+	slot.type = type;
+	if(inFile) _file->count.store(index + 1, std::memory_order_release);
+	return slot;
+}
+
+}
+
+void MetricsText::set(const std::string& value)
+{
+	char buffer[sizeof(_slot.text)] = {};
+	std::memcpy(buffer, value.data(), std::min(value.size(), sizeof(buffer) - 1));
+
+	uint32_t sequence = _slot.sequence.load(std::memory_order_relaxed);
+	_slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	for(size_t i = 0; i < sizeof(_slot.text) / sizeof(uint64_t); i++)
+	{
+		uint64_t word = 0;
+		std::memcpy(&word, buffer + i * sizeof(uint64_t), sizeof(uint64_t));
+		_slot.text[i].store(word, std::memory_order_relaxed);
+	}
+	_slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void startMetrics(const std::string& filename, const std::string& program)
+{
+	std::lock_guard<std::mutex> metricsGuard(_metricsMutex);
+	if(_added)
+	{
+		std::cerr << "Metrics were added before startMetrics()." << std::endl;
+		exit(1);
+	}
+
+	std::string temporaryFilename = filename + ".tmp";
+	int32_t fileDescriptor = open(temporaryFilename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(fileDescriptor == -1 || ftruncate(fileDescriptor, sizeof(MetricsFile)) != 0)
+	{
+		std::cerr << "Could not create metrics file " << filename << ": " << strerror(errno) << std::endl;
+		exit(1);
+	}
+	void* memory = mmap(nullptr, sizeof(MetricsFile), PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+	close(fileDescriptor);
+	if(memory == MAP_FAILED)
+	{
+		std::cerr << "Could not map metrics file " << filename << ": " << strerror(errno) << std::endl;
+		exit(1);
+	}
+
+	// The file is zero-filled, which is a valid state for all atomics
+	_file = (MetricsFile*)memory;
+	_file->version = metricsVersion;
+	_file->pid = getpid();
+	_file->startTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	copyString(_file->program, sizeof(_file->program), program);
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(_file->magic, _magic, sizeof(_magic));
+
+	if(rename(temporaryFilename.c_str(), filename.c_str()) != 0)
+	{
+		std::cerr << "Could not create metrics file " << filename << ": " << strerror(errno) << std::endl;
+		exit(1);
+	}
+	_enabled = true;
+}
+
+bool isMetricsEnabled()
+{
+	return _enabled;
+}
+
+std::atomic<int64_t>& addCounter(const std::string& name, const std::string& help)
+{
+	return addSlot(name, help, MetricType::counter).values[0];
+}
+
+std::atomic<int64_t>& addGauge(const std::string& name, const std::string& help)
+{
+	return addSlot(name, help, MetricType::gauge).values[0];
+}
+
+MetricsHistogram& addHistogram(const std::string& name, const std::string& help)
+{
+	MetricSlot& slot = addSlot(name, help, MetricType::histogram);
+	std::lock_guard<std::mutex> metricsGuard(_metricsMutex);
+	_histograms.emplace_back(slot);
+	return _histograms.back();
+}
+
+MetricsText& addText(const std::string& name, const std::string& help)
+{
+	MetricSlot& slot = addSlot(name, help, MetricType::text);
+	std::lock_guard<std::mutex> metricsGuard(_metricsMutex);
+	_texts.emplace_back(slot);
+	return _texts.back();
+}
+
+const MetricsFile* openMetrics(const std::string& filename)
+{
+	int32_t fileDescriptor = open(filename.c_str(), O_RDONLY);
+	if(fileDescriptor == -1) return nullptr;
+	struct stat fileInfo{};
+	if(fstat(fileDescriptor, &fileInfo) != 0 || fileInfo.st_size != sizeof(MetricsFile))
+	{
+		close(fileDescriptor);
+		return nullptr;
+	}
+	void* memory = mmap(nullptr, sizeof(MetricsFile), PROT_READ, MAP_SHARED, fileDescriptor, 0);
+	close(fileDescriptor);
+	if(memory == MAP_FAILED) return nullptr;
+
+	const MetricsFile* file = (const MetricsFile*)memory;
+	if(std::memcmp(file->magic, _magic, sizeof(_magic)) != 0 || file->version != metricsVersion)
+	{
+		munmap(memory, sizeof(MetricsFile));
+		return nullptr;
+	}
+	return file;
+}
+
+std::string getMetricsText(const MetricSlot& slot)
+{
+	// A writer killed while setting the text leaves the sequence odd forever, so the retries are bounded
+	char buffer[sizeof(slot.text) + 1] = {};
+	for(int32_t retries = 0; retries < 1000; retries++)
+	{
+		uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+		if(sequence & 1)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		for(size_t i = 0; i < sizeof(slot.text) / sizeof(uint64_t); i++)
+		{
+			uint64_t word = slot.text[i].load(std::memory_order_relaxed);
+			std::memcpy(buffer + i * sizeof(uint64_t), &word, sizeof(uint64_t));
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if(slot.sequence.load(std::memory_order_relaxed) == sequence) return std::string(buffer);
+	}
+	return "";
+}
+
+double getMetricsQuantile(const MetricSlot& slot, double quantile)
+{
+	int64_t count = slot.values[0].load(std::memory_order_relaxed);
+	if(count <= 0) return 0;
+
+	// Interpolated linearly within the bucket. Buckets are filled before the count, so they may hold a few more values.
+	double rank = quantile * count;
+	int64_t cumulative = 0;
+	for(uint32_t i = 0; i < metricsBuckets; i++)
+	{
+		int64_t bucketCount = slot.values[i + 2].load(std::memory_order_relaxed);
+		if(bucketCount == 0 || cumulative + bucketCount < rank)
+		{
+			cumulative += bucketCount;
+			continue;
+		}
+		double lower = i == 0 ? 0 : (double)((int64_t)1 << (i - 1));
+		double upper = (double)((int64_t)1 << i);
+		return lower + (upper - lower) * (rank - cumulative) / bucketCount;
+	}
+	return (double)((int64_t)1 << (metricsBuckets - 1));
+}
@@ -0,0 +1,118 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Live counters and gauges of a running process in a memory-mapped file, read with "monitor". Updates are single
+ * relaxed atomic operations without locks or system calls, so they can be placed in the hot loops. Metrics are added
+ * at startup. Without startMetrics() they are kept in process memory only, so callers don't need to check whether
+ * metrics are enabled. The same applies to metrics added after the file's metricsCapacity slots are used up.
+ */
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Metrics shared between processes need lock-free 64-bit atomics.");
+
+enum class MetricType : uint32_t
+{
+	counter = 1,
+	gauge = 2,
+	histogram = 3,
+	text = 4
+};
+
+const uint32_t metricsVersion = 1;
+const uint32_t metricsCapacity = 64;
+const uint32_t metricsBuckets = 32; // Histogram bucket i counts values below 2^i
+
+/**
+ * One metric in the file. The name may contain Prometheus labels, e. g. "frames_total{receiver=\"R1\"}". Counters and
+ * gauges use values[0]. Histograms store the count in values[0], the sum in values[1] and the buckets after that. Text
+ * is written under a sequence lock: sequence is odd while the text changes.
+ */
+struct MetricSlot
+{
+	char name[96];
+	char help[128];
+	MetricType type;
+	std::atomic<uint32_t> sequence;
+	std::atomic<int64_t> values[metricsBuckets + 2];
+	std::atomic<uint64_t> text[8];
+};
+
+struct MetricsFile
+{
+	char magic[8]; // "HGEOMTRC", written last
+	uint32_t version;
+	int32_t pid;
+	int64_t startTime; // Milliseconds since the epoch
+	char program[32];
+	std::atomic<uint32_t> count; // Slots in use, published after the slot is complete
+	uint32_t reserved;
+	MetricSlot slots[metricsCapacity];
+};
+
+class MetricsHistogram
+{
+public:
+	explicit MetricsHistogram(MetricSlot& slot) : _slot(slot) {}
+
+	void observe(int64_t value)
+	{
+		uint32_t bucket = 0;
+		while(bucket < metricsBuckets - 1 && value >= ((int64_t)1 << bucket)) bucket++;
+		_slot.values[bucket + 2].fetch_add(1, std::memory_order_relaxed);
+		_slot.values[1].fetch_add(value, std::memory_order_relaxed);
+		_slot.values[0].fetch_add(1, std::memory_order_relaxed);
+	}
+private:
+	MetricSlot& _slot;
+};
+
+/**
+ * Text like the current EEP and step. Only one thread may set a text.
+ */
+class MetricsText
+{
+public:
+	explicit MetricsText(MetricSlot& slot) : _slot(slot) {}
+
+	void set(const std::string& value);
+private:
+	MetricSlot& _slot;
+};
+
+/**
+ * Creates filename for program. Must be called before the first metric is added. The file is replaced atomically, so
+ * readers of a previous run's file never see a partial file.
+ */
+void startMetrics(const std::string& filename, const std::string& program);
+
+bool isMetricsEnabled();
+
+std::atomic<int64_t>& addCounter(const std::string& name, const std::string& help);
+std::atomic<int64_t>& addGauge(const std::string& name, const std::string& help);
+
+/**
+ * For durations in microseconds.
+ */
+MetricsHistogram& addHistogram(const std::string& name, const std::string& help);
+MetricsText& addText(const std::string& name, const std::string& help);
+
+/**
+ * Maps a metrics file read-only. Returns nullptr when filename is not a metrics file of this version.
+ */
+const MetricsFile* openMetrics(const std::string& filename);
+
+/**
+ * Returns "" when the text doesn't settle, e. g. because its writer was killed while setting it.
+ */
+std::string getMetricsText(const MetricSlot& slot);
+
+/**
+ * Estimates the quantile (0 to 1) of a histogram from its buckets.
+ */
+double getMetricsQuantile(const MetricSlot& slot, double quantile);
+
+#endif
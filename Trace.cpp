@@ -0,0 +1,254 @@
+#include "Trace.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+namespace
+{
+
+struct TraceEvent
+{
+	const char* name;
+	int64_t start;
+	int64_t end;
+	int32_t track;
+	uint64_t asyncId;
+	char detail[48];
+};
+
+/**
+ * Written by one thread only. size is published after the event is complete, so the reader only sees finished events.
+ */
+struct TraceChunk
+{
+	explicit TraceChunk(size_t capacity) : events(new TraceEvent[capacity]), capacity(capacity) {}
+
+	std::unique_ptr<TraceEvent[]> events;
+	size_t capacity;
+	std::atomic<size_t> size{0};
+	std::atomic<TraceChunk*> next{nullptr};
+};
+
+struct TraceBuffer
+{
+	std::string name;
+	int32_t track = 0;
+	TraceChunk* first = nullptr;
+	TraceChunk* last = nullptr; // Only used by the owning thread
+};
+
+/**
+ * Buffers and chunks are never freed: Threads may still record while the program exits.
+ */
+struct TraceState
+{
+	std::mutex mutex;
+	std::string filename;
+	int64_t startTime = 0;
+	std::atomic<int32_t> nextTrack{1};
+	std::atomic<uint64_t> nextId{1};
+	std::atomic<bool> written{false};
+	std::vector<TraceBuffer*> buffers;
+	std::multimap<std::string, TraceBuffer*> freeBuffers; // Buffers of ended threads by thread name
+	std::map<int32_t, std::string> trackNames;
+	std::map<std::string, int32_t> nameCounts;
+};
+
+std::atomic<bool> _tracing{false};
+TraceState* _state = new TraceState();
+
+/**
+ * Called on thread start or when a thread is renamed, so the mutex is not taken while recording.
+ */
+TraceBuffer* acquireBuffer(const std::string& name)
+{
+	std::lock_guard<std::mutex> stateGuard(_state->mutex);
+	auto freeIterator = _state->freeBuffers.find(name);
+	if(freeIterator != _state->freeBuffers.end())
+	{
+		TraceBuffer* buffer = freeIterator->second;
+		_state->freeBuffers.erase(freeIterator);
+		return buffer;
+	}
+
+	TraceBuffer* buffer = new TraceBuffer();
+	buffer->name = name;
+	buffer->track = _state->nextTrack++;
+	buffer->first = new TraceChunk(64);
+	buffer->last = buffer->first;
+	_state->buffers.push_back(buffer);
+	int32_t count = ++_state->nameCounts[name];
+	_state->trackNames[buffer->track] = count == 1 ? name : name + " " + std::to_string(count);
+	return buffer;
+}
+
+void releaseBuffer(TraceBuffer* buffer)
+{
+	std::lock_guard<std::mutex> stateGuard(_state->mutex);
+	_state->freeBuffers.insert(std::make_pair(buffer->name, buffer));
+}
+
+struct TraceThread
+{
+	TraceBuffer* buffer = nullptr;
+
+	~TraceThread()
+	{
+		if(buffer) releaseBuffer(buffer);
+	}
+};
+
+thread_local TraceThread _thread;
+
+TraceBuffer* getThreadBuffer()
+{
+	if(!_thread.buffer) _thread.buffer = acquireBuffer("Thread");
+	return _thread.buffer;
+}
+
+void writeEscaped(std::ostream& stream, const std::string& value)
+{
+	for(char c : value)
+	{
+		if(c == '"' || c == '\\') stream << '\\' << c;
+		else if((uint8_t)c < 0x20) stream << ' ';
+		else stream << c;
+	}
+}
+
+void writeTrace()
+{
+	if(_state->written.exchange(true)) return;
+	std::lock_guard<std::mutex> stateGuard(_state->mutex);
+
+	std::string temporaryFilename = _state->filename + ".tmp";
+	std::ofstream file(temporaryFilename, std::ios::trunc);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"homegear-enocean-tests\"}}";
+	for(auto& trackName : _state->trackNames)
+	{
+		file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << trackName.first << ",\"args\":{\"name\":\"";
+		writeEscaped(file, trackName.second);
+		file << "\"}}";
+		file << ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << trackName.first << ",\"args\":{\"sort_index\":" << trackName.first << "}}";
+	}
+
+	int64_t eventCount = 0;
+	for(auto buffer : _state->buffers)
+	{
+		for(TraceChunk* chunk = buffer->first; chunk; chunk = chunk->next.load(std::memory_order_acquire))
+		{
+			size_t size = chunk->size.load(std::memory_order_acquire);
+			for(size_t i = 0; i < size; i++)
+			{
+				const TraceEvent& event = chunk->events[i];
+				int32_t track = event.track == 0 ? buffer->track : event.track;
+				int64_t start = event.start - _state->startTime;
+				file << ",\n{\"name\":\"" << event.name << "\",\"pid\":1,\"tid\":" << track << ",\"ts\":" << start;
+				if(event.asyncId == 0) file << ",\"ph\":\"X\",\"dur\":" << (event.end - event.start);
+				else file << ",\"ph\":\"b\",\"cat\":\"" << event.name << "\",\"id\":" << event.asyncId;
+				if(event.detail[0]) file << ",\"args\":{\"detail\":\"" << event.detail << "\"}";
+				file << '}';
+				if(event.asyncId != 0) file << ",\n{\"name\":\"" << event.name << "\",\"pid\":1,\"tid\":" << track << ",\"ts\":" << (event.end - _state->startTime) << ",\"ph\":\"e\",\"cat\":\"" << event.name << "\",\"id\":" << event.asyncId << '}';
+				eventCount++;
+			}
+		}
+	}
+	file << "\n]}\n";
+	file.close();
+
+	if(!file || rename(temporaryFilename.c_str(), _state->filename.c_str()) != 0)
+	{
+		std::cerr << "Could not write trace to " << _state->filename << std::endl;
+		return;
+	}
+	std::cout << "Wrote " << eventCount << " trace events to " << _state->filename << std::endl;
+}
+
+}
+
+void startTrace(const std::string& filename)
+{
+	_state->filename = filename;
+	_state->startTime = getTraceTime();
+	_tracing = true;
+	std::atexit(writeTrace);
+}
+
+bool isTracing()
+{
+	return _tracing.load(std::memory_order_relaxed);
+}
+
+int32_t addTraceTrack(const std::string& name)
+{
+	std::lock_guard<std::mutex> stateGuard(_state->mutex);
+	int32_t track = _state->nextTrack++;
+	_state->trackNames[track] = name;
+	return track;
+}
+
+void setTraceThreadName(const std::string& name)
+{
+	if(!isTracing() || (_thread.buffer && _thread.buffer->name == name)) return;
+	if(_thread.buffer) releaseBuffer(_thread.buffer);
+	_thread.buffer = acquireBuffer(name);
+}
+
+int64_t getTraceTime()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t getTraceId()
+{
+	return _state->nextId++;
+}
+
+void recordTraceSpan(const char* name, const std::string& detail, int64_t start, int64_t end, int32_t track, uint64_t asyncId)
+{
+	if(!isTracing()) return;
+	TraceBuffer* buffer = getThreadBuffer();
+	TraceChunk* chunk = buffer->last;
+	size_t size = chunk->size.load(std::memory_order_relaxed);
+	if(size == chunk->capacity)
+	{
+		TraceChunk* next = new TraceChunk(std::min(chunk->capacity * 2, (size_t)16384));
+		chunk->next.store(next, std::memory_order_release);
+		buffer->last = next;
+		chunk = next;
+		size = 0;
+	}
+
+	TraceEvent& event = chunk->events[size];
+	event.name = name;
+	event.start = start;
+	event.end = end;
+	event.track = track;
+	event.asyncId = asyncId;
+	size_t detailSize = std::min(detail.size(), sizeof(event.detail) - 1);
+	for(size_t i = 0; i < detailSize; i++) event.detail[i] = detail[i] == '"' || detail[i] == '\\' || (uint8_t)detail[i] < 0x20 ? ' ' : detail[i];
+	event.detail[detailSize] = 0;
+	chunk->size.store(size + 1, std::memory_order_release);
+}
+
+TraceSpan::TraceSpan(const char* name, const std::string& detail, int32_t track) : _name(name), _track(track), _start(0)
+{
+	if(!isTracing()) return;
+	_detail = detail;
+	_start = getTraceTime();
+}
+
+TraceSpan::~TraceSpan()
+{
+	if(_start != 0) recordTraceSpan(_name, _detail, _start, getTraceTime(), _track);
+}
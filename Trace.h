@@ -0,0 +1,65 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <string>
+#include <cstdint>
+
+/**
+ * Timeline of a test run in the trace event format of Perfetto and chrome://tracing. Every thread records into its
+ * own buffer without locking. The buffers are only read when the file is written at exit. Nothing is recorded until
+ * startTrace() was called.
+ */
+
+/**
+ * Enables recording and writes the trace to filename when the program exits, also on failed tests.
+ */
+void startTrace(const std::string& filename);
+
+bool isTracing();
+
+/**
+ * Creates a track not tied to a thread, e. g. for a serial device. Returns the track to pass to TraceSpan.
+ */
+int32_t addTraceTrack(const std::string& name);
+
+/**
+ * Names the calling thread's track. Threads with the same name share their tracks once they ended, so the short-lived
+ * RPC threads of the sweeps don't add a track per step.
+ */
+void setTraceThreadName(const std::string& name);
+
+/**
+ * Microseconds of a monotonic clock.
+ */
+int64_t getTraceTime();
+
+/**
+ * Returns an ID for recordTraceSpan()'s asyncId.
+ */
+uint64_t getTraceId();
+
+/**
+ * Records a span measured by the caller. With track 0 the span is placed on the calling thread's track. Spans with an
+ * asyncId may overlap others and are shown on their own row, e. g. pipelined sweep steps.
+ */
+void recordTraceSpan(const char* name, const std::string& detail, int64_t start, int64_t end, int32_t track = 0, uint64_t asyncId = 0);
+
+/**
+ * Records the span from construction to destruction.
+ */
+class TraceSpan
+{
+public:
+	explicit TraceSpan(const char* name, const std::string& detail = std::string(), int32_t track = 0);
+	~TraceSpan();
+
+	TraceSpan(const TraceSpan&) = delete;
+	TraceSpan& operator=(const TraceSpan&) = delete;
+private:
+	const char* _name;
+	std::string _detail;
+	int32_t _track;
+	int64_t _start;
+};
+
+#endif
@@ -0,0 +1,379 @@
+#include "Transport.h"
+
+#include <homegear-base/BaseLib.h>
+
+#include <iostream>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+namespace
+{
+
+const uint8_t _crc8Table[256] = {
+	0x00, 0x07, 0x0e, 0x09, 0x1c, 0x1b, 0x12, 0x15,
+	0x38, 0x3f, 0x36, 0x31, 0x24, 0x23, 0x2a, 0x2d,
+	0x70, 0x77, 0x7e, 0x79, 0x6c, 0x6b, 0x62, 0x65,
+	0x48, 0x4f, 0x46, 0x41, 0x54, 0x53, 0x5a, 0x5d,
+	0xe0, 0xe7, 0xee, 0xe9, 0xfc, 0xfb, 0xf2, 0xf5,
+	0xd8, 0xdf, 0xd6, 0xd1, 0xc4, 0xc3, 0xca, 0xcd,
+	0x90, 0x97, 0x9e, 0x99, 0x8c, 0x8b, 0x82, 0x85,
+	0xa8, 0xaf, 0xa6, 0xa1, 0xb4, 0xb3, 0xba, 0xbd,
+	0xc7, 0xc0, 0xc9, 0xce, 0xdb, 0xdc, 0xd5, 0xd2,
+	0xff, 0xf8, 0xf1, 0xf6, 0xe3, 0xe4, 0xed, 0xea,
+	0xb7, 0xb0, 0xb9, 0xbe, 0xab, 0xac, 0xa5, 0xa2,
+	0x8f, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9d, 0x9a,
+	0x27, 0x20, 0x29, 0x2e, 0x3b, 0x3c, 0x35, 0x32,
+	0x1f, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0d, 0x0a,
+	0x57, 0x50, 0x59, 0x5e, 0x4b, 0x4c, 0x45, 0x42,
+	0x6f, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7d, 0x7a,
+	0x89, 0x8e, 0x87, 0x80, 0x95, 0x92, 0x9b, 0x9c,
+	0xb1, 0xb6, 0xbf, 0xb8, 0xad, 0xaa, 0xa3, 0xa4,
+	0xf9, 0xfe, 0xf7, 0xf0, 0xe5, 0xe2, 0xeb, 0xec,
+	0xc1, 0xc6, 0xcf, 0xc8, 0xdd, 0xda, 0xd3, 0xd4,
+	0x69, 0x6e, 0x67, 0x60, 0x75, 0x72, 0x7b, 0x7c,
+	0x51, 0x56, 0x5f, 0x58, 0x4d, 0x4a, 0x43, 0x44,
+	0x19, 0x1e, 0x17, 0x10, 0x05, 0x02, 0x0b, 0x0c,
+	0x21, 0x26, 0x2f, 0x28, 0x3d, 0x3a, 0x33, 0x34,
+	0x4e, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5c, 0x5b,
+	0x76, 0x71, 0x78, 0x7f, 0x6A, 0x6d, 0x64, 0x63,
+	0x3e, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2c, 0x2b,
+	0x06, 0x01, 0x08, 0x0f, 0x1a, 0x1d, 0x14, 0x13,
+	0xae, 0xa9, 0xa0, 0xa7, 0xb2, 0xb5, 0xbc, 0xbb,
+	0x96, 0x91, 0x98, 0x9f, 0x8a, 0x8D, 0x84, 0x83,
+	0xde, 0xd9, 0xd0, 0xd7, 0xc2, 0xc5, 0xcc, 0xcb,
+	0xe6, 0xe1, 0xe8, 0xef, 0xfa, 0xfd, 0xf4, 0xf3
+};
+
+std::vector<char> getEsp3Packet(uint8_t type, const std::vector<char>& data, const std::vector<char>& optionalData)
+{
+	std::vector<char> packet{ 0x55, (char)(uint8_t)(data.size() >> 8), (char)(uint8_t)(data.size() & 0xFF), (char)(uint8_t)optionalData.size(), (char)type, 0 };
+	packet.insert(packet.end(), data.begin(), data.end());
+	packet.insert(packet.end(), optionalData.begin(), optionalData.end());
+	packet.push_back(0);
+	setEsp3Crcs(packet);
+	return packet;
+}
+
+void setNonBlocking(int32_t descriptor)
+{
+	fcntl(descriptor, F_SETFL, fcntl(descriptor, F_GETFL) | O_NONBLOCK);
+}
+
+void sendAll(int32_t descriptor, const std::vector<char>& data)
+{
+	size_t position = 0;
+	while(position < data.size())
+	{
+		ssize_t bytesSent = send(descriptor, data.data() + position, data.size() - position, MSG_NOSIGNAL);
+		if(bytesSent > 0) position += bytesSent;
+		else if(bytesSent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+		{
+			pollfd pollInfo{ descriptor, POLLOUT, 0 };
+			poll(&pollInfo, 1, 1000);
+		}
+		else return;
+	}
+}
+
+/**
+ * Single threaded: One poll() over the listening socket and all clients.
+ */
+void runLoopbackGateway(int32_t listenSocket)
+{
+	struct Client
+	{
+		int32_t socket;
+		std::vector<char> buffer;
+	};
+	std::vector<Client> clients;
+
+	while(true)
+	{
+		std::vector<pollfd> pollInfos{ pollfd{ listenSocket, POLLIN, 0 } };
+		for(auto& client : clients) pollInfos.push_back(pollfd{ client.socket, POLLIN, 0 });
+		if(poll(pollInfos.data(), pollInfos.size(), -1) == -1)
+		{
+			if(errno == EINTR) continue;
+			return;
+		}
+
+		if(pollInfos[0].revents & POLLIN)
+		{
+			int32_t clientSocket = accept(listenSocket, nullptr, nullptr);
+			if(clientSocket != -1)
+			{
+				int32_t noDelay = 1;
+				setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+				clients.push_back(Client{ clientSocket, std::vector<char>() });
+			}
+		}
+
+		for(size_t i = 1; i < pollInfos.size(); i++)
+		{
+			if(!pollInfos[i].revents) continue;
+			Client& client = clients.at(i - 1);
+			char buffer[1024];
+			ssize_t bytesRead = recv(client.socket, buffer, sizeof(buffer), 0);
+			if(bytesRead <= 0)
+			{
+				::close(client.socket);
+				client.socket = -1;
+				continue;
+			}
+			client.buffer.insert(client.buffer.end(), buffer, buffer + bytesRead);
+
+			while(true)
+			{
+				std::vector<char>::iterator start = std::find(client.buffer.begin(), client.buffer.end(), 0x55);
+				client.buffer.erase(client.buffer.begin(), start);
+				if(client.buffer.size() < 6) break;
+				uint32_t dataSize = ((uint32_t)(uint8_t)client.buffer[1] << 8) | (uint8_t)client.buffer[2];
+				uint32_t size = dataSize + (uint8_t)client.buffer[3] + 7;
+				if(client.buffer.size() < size) break;
+				std::vector<char> packet(client.buffer.begin(), client.buffer.begin() + size);
+				client.buffer.erase(client.buffer.begin(), client.buffer.begin() + size);
+
+				uint8_t type = packet[4];
+				if(type == 5 && dataSize >= 1 && packet[6] == 8) sendAll(client.socket, getEsp3Packet(2, std::vector<char>{ 0, (char)(uint8_t)0xFF, (char)(uint8_t)0x80, 0, 0 }, std::vector<char>{ 10 })); // CO_RD_IDBASE
+				else sendAll(client.socket, getEsp3Packet(2, std::vector<char>{ 0 }, std::vector<char>()));
+
+				if(type == 1)
+				{
+					// Received telegram: Subtelegram count, broadcast destination, -45 dBm, no security
+					std::vector<char> radioPacket = getEsp3Packet(1, std::vector<char>(packet.begin() + 6, packet.begin() + 6 + dataSize), std::vector<char>{ 1, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 45, 0 });
+					for(auto& receiver : clients)
+					{
+						if(&receiver != &client && receiver.socket != -1) sendAll(receiver.socket, radioPacket);
+					}
+				}
+			}
+		}
+
+		clients.erase(std::remove_if(clients.begin(), clients.end(), [](const Client& client) { return client.socket == -1; }), clients.end());
+	}
+}
+
+}
+
+uint8_t getCrc8(const char* data, size_t size)
+{
+	uint8_t crc8 = 0;
+	for(size_t i = 0; i < size; i++) crc8 = _crc8Table[crc8 ^ (uint8_t)data[i]];
+	return crc8;
+}
+
+void setEsp3Crcs(std::vector<char>& packet)
+{
+	packet[5] = getCrc8(packet.data() + 1, 4);
+	packet.back() = getCrc8(packet.data() + 6, packet.size() - 7);
+}
+
+SerialTransport::SerialTransport(BaseLib::SharedObjects* bl, const std::string& device) : _serial(new BaseLib::SerialReaderWriter(bl, device, 57600, 0, true, -1))
+{
+}
+
+SerialTransport::~SerialTransport()
+{
+}
+
+void SerialTransport::open()
+{
+	_serial->openDevice(false, false, false);
+}
+
+void SerialTransport::close()
+{
+	_serial->closeDevice();
+}
+
+void SerialTransport::reconnect()
+{
+	_serial->closeDevice();
+	_serial->openDevice(false, false, false);
+}
+
+int32_t SerialTransport::fileDescriptor()
+{
+	return _serial->fileDescriptor()->descriptor;
+}
+
+ssize_t SerialTransport::read(char* buffer, size_t size)
+{
+	ssize_t bytesRead = ::read(fileDescriptor(), buffer, size);
+	if(bytesRead == -1 && (errno == EAGAIN || errno == EINTR)) return 0;
+	return bytesRead <= 0 ? -1 : bytesRead;
+}
+
+void SerialTransport::write(const std::vector<char>& data)
+{
+	_serial->writeData(data);
+}
+
+void SerialTransport::flushInput()
+{
+	tcflush(fileDescriptor(), TCIFLUSH);
+}
+
+TcpTransport::TcpTransport(const std::string& host, int32_t port, bool noDelay) : _host(host), _port(port), _noDelay(noDelay)
+{
+}
+
+TcpTransport::~TcpTransport()
+{
+	close();
+}
+
+void TcpTransport::open()
+{
+	close();
+
+	addrinfo hints{};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* addresses = nullptr;
+	if(getaddrinfo(_host.c_str(), std::to_string(_port).c_str(), &hints, &addresses) != 0 || !addresses)
+	{
+		throw BaseLib::Exception("Could not resolve " + _host);
+	}
+	for(addrinfo* address = addresses; address && _socket == -1; address = address->ai_next)
+	{
+		_socket = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+		if(_socket == -1) continue;
+		if(connect(_socket, address->ai_addr, address->ai_addrlen) == -1)
+		{
+			::close(_socket);
+			_socket = -1;
+		}
+	}
+	freeaddrinfo(addresses);
+	if(_socket == -1)
+	{
+		throw BaseLib::Exception("Could not connect to " + _host + ":" + std::to_string(_port) + ": " + strerror(errno));
+	}
+
+	int32_t noDelay = _noDelay ? 1 : 0;
+	setsockopt(_socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+	setNonBlocking(_socket);
+}
+
+void TcpTransport::close()
+{
+	if(_socket == -1) return;
+	::close(_socket);
+	_socket = -1;
+}
+
+ssize_t TcpTransport::read(char* buffer, size_t size)
+{
+	ssize_t bytesRead = recv(_socket, buffer, size, 0);
+	if(bytesRead == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 0;
+	return bytesRead <= 0 ? -1 : bytesRead;
+}
+
+void TcpTransport::write(const std::vector<char>& data)
+{
+	std::lock_guard<std::mutex> writeGuard(_writeMutex);
+	_writeBuffer.insert(_writeBuffer.end(), data.begin(), data.end());
+	flush();
+}
+
+/**
+ * Sends all queued bytes. Waits for the socket to become writable when the bridge doesn't keep up, everything written
+ * in the meantime by other threads is queued behind and goes out with the next send().
+ */
+void TcpTransport::flush()
+{
+	while(!_writeBuffer.empty())
+	{
+		ssize_t bytesSent = send(_socket, _writeBuffer.data(), _writeBuffer.size(), MSG_NOSIGNAL);
+		if(bytesSent > 0)
+		{
+			_writeBuffer.erase(_writeBuffer.begin(), _writeBuffer.begin() + bytesSent);
+			continue;
+		}
+		if(bytesSent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+		{
+			pollfd pollInfo{ _socket, POLLOUT, 0 };
+			_writeMutex.unlock();
+			poll(&pollInfo, 1, 1000);
+			_writeMutex.lock();
+			continue;
+		}
+		throw BaseLib::Exception("Could not write to " + _host + ":" + std::to_string(_port) + ": " + strerror(errno));
+	}
+}
+
+void TcpTransport::flushInput()
+{
+	char buffer[1024];
+	while(read(buffer, sizeof(buffer)) > 0);
+}
+
+int32_t startLoopbackGateway(int32_t port)
+{
+	int32_t listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+	int32_t reuseAddress = 1;
+	setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuseAddress, sizeof(reuseAddress));
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+	socklen_t addressSize = sizeof(address);
+	if(listenSocket == -1 || bind(listenSocket, (sockaddr*)&address, sizeof(address)) == -1 || listen(listenSocket, 8) == -1 || getsockname(listenSocket, (sockaddr*)&address, &addressSize) == -1)
+	{
+		std::string error(strerror(errno));
+		if(listenSocket != -1) ::close(listenSocket);
+		throw BaseLib::Exception("Could not start loopback gateway on port " + std::to_string(port) + ": " + error);
+	}
+	port = ntohs(address.sin_port);
+	std::cout << "Loopback gateway listening on 127.0.0.1:" << port << std::endl;
+	std::thread(runLoopbackGateway, listenSocket).detach();
+	return port;
+}
+
+std::unique_ptr<Transport> createTransport(const std::string& address, BaseLib::SharedObjects* bl)
+{
+	if(address == "loopback" || address.compare(0, 9, "loopback:") == 0)
+	{
+		int32_t port = startLoopbackGateway(address.size() > 9 ? BaseLib::Math::getNumber(address.substr(9)) : 0);
+		return std::unique_ptr<Transport>(new TcpTransport("127.0.0.1", port));
+	}
+	if(address.compare(0, 6, "tcp://") == 0)
+	{
+		std::string hostAndPort = address.substr(6);
+		bool noDelay = true;
+		size_t optionsPosition = hostAndPort.find('?');
+		if(optionsPosition != std::string::npos)
+		{
+			std::string options = hostAndPort.substr(optionsPosition + 1);
+			hostAndPort = hostAndPort.substr(0, optionsPosition);
+			if(options == "nodelay=0") noDelay = false;
+			else if(options != "nodelay=1") throw BaseLib::Exception("Invalid TCP option: " + options + " (expected \"nodelay=0\" or \"nodelay=1\")");
+		}
+		size_t portPosition = hostAndPort.rfind(':');
+		if(portPosition == std::string::npos || portPosition == 0)
+		{
+			throw BaseLib::Exception("Invalid TCP address: " + address + " (expected \"tcp://HOST:PORT\")");
+		}
+		std::string host = hostAndPort.substr(0, portPosition);
+		if(host.size() > 2 && host.front() == '[' && host.back() == ']') host = host.substr(1, host.size() - 2);
+		return std::unique_ptr<Transport>(new TcpTransport(host, BaseLib::Math::getNumber(hostAndPort.substr(portPosition + 1)), noDelay));
+	}
+	return std::unique_ptr<Transport>(new SerialTransport(bl, address));
+}
+
+bool isTransportAddress(const std::string& address)
+{
+	return address.find('/') != std::string::npos || address == "loopback" || address.compare(0, 9, "loopback:") == 0;
+}
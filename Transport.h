@@ -0,0 +1,127 @@
+#ifndef TRANSPORT_H_
+#define TRANSPORT_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <sys/types.h>
+
+namespace BaseLib
+{
+class SharedObjects;
+class SerialReaderWriter;
+}
+
+/**
+ * ESP3 CRC8 (polynomial 0x07) over size bytes of data.
+ */
+uint8_t getCrc8(const char* data, size_t size);
+
+/**
+ * Fills in the header and data CRCs of a complete ESP3 packet.
+ */
+void setEsp3Crcs(std::vector<char>& packet);
+
+/**
+ * Byte stream to an ESP3 gateway. Reading is done with poll() on fileDescriptor() followed by read(), so callers can
+ * wait for data with a deadline without spending CPU time. open(), reconnect() and write() throw BaseLib::Exception on
+ * errors, so the caller decides whether to exit or to stop its tests first.
+ */
+class Transport
+{
+public:
+	virtual ~Transport() {}
+
+	virtual void open() = 0;
+	virtual void close() = 0;
+
+	/**
+	 * Called before every frame. A USB 300 resets its duty cycle counter when the serial device is reopened.
+	 */
+	virtual void reconnect() = 0;
+
+	virtual int32_t fileDescriptor() = 0;
+
+	/**
+	 * Returns the number of bytes read, 0 when nothing is available and -1 on errors or when the connection was closed.
+	 */
+	virtual ssize_t read(char* buffer, size_t size) = 0;
+
+	virtual void write(const std::vector<char>& data) = 0;
+
+	/**
+	 * Discards everything received but not read yet.
+	 */
+	virtual void flushInput() = 0;
+};
+
+/**
+ * A local serial device, e. g. "/dev/ttyUSB0".
+ */
+class SerialTransport : public Transport
+{
+public:
+	SerialTransport(BaseLib::SharedObjects* bl, const std::string& device);
+	virtual ~SerialTransport();
+
+	virtual void open();
+	virtual void close();
+	virtual void reconnect();
+	virtual int32_t fileDescriptor();
+	virtual ssize_t read(char* buffer, size_t size);
+	virtual void write(const std::vector<char>& data);
+	virtual void flushInput();
+private:
+	std::unique_ptr<BaseLib::SerialReaderWriter> _serial;
+};
+
+/**
+ * A gateway behind a raw TCP bridge like ser2net, e. g. "tcp://192.168.0.20:3000". The socket is non-blocking with
+ * TCP_NODELAY set unless noDelay is false, so frames leave without waiting for Nagle's algorithm. Writes are queued and everything queued is
+ * sent with as few send() calls as possible, so frames written while the socket is congested are coalesced. The
+ * bridge keeps the serial device open, so reconnect() does nothing: The duty cycle reset only works with local devices.
+ */
+class TcpTransport : public Transport
+{
+public:
+	TcpTransport(const std::string& host, int32_t port, bool noDelay = true);
+	virtual ~TcpTransport();
+
+	virtual void open();
+	virtual void close();
+	virtual void reconnect() {}
+	virtual int32_t fileDescriptor() { return _socket; }
+	virtual ssize_t read(char* buffer, size_t size);
+	virtual void write(const std::vector<char>& data);
+	virtual void flushInput();
+private:
+	std::string _host;
+	int32_t _port = 0;
+	bool _noDelay = true;
+	int32_t _socket = -1;
+	std::mutex _writeMutex;
+	std::vector<char> _writeBuffer;
+
+	void flush();
+};
+
+/**
+ * Starts a stand-in gateway in a background thread listening on 127.0.0.1:port (0 for any free port) and returns the
+ * port. It behaves like a USB 300 for the commands used here: CO_RD_IDBASE is answered with the base ID FF800000, all
+ * other packets with RET_OK. Radio telegrams are forwarded to all other connected clients as received telegrams, so a
+ * sniffer connected to the same stand-in sees what the tests send.
+ */
+int32_t startLoopbackGateway(int32_t port);
+
+/**
+ * Creates the transport for address: "tcp://HOST:PORT" with an optional "?nodelay=0" to leave Nagle's algorithm on,
+ * "loopback" or "loopback:PORT" for a stand-in gateway started with startLoopbackGateway(), everything else is a serial
+ * device. Throws BaseLib::Exception on invalid addresses.
+ */
+std::unique_ptr<Transport> createTransport(const std::string& address, BaseLib::SharedObjects* bl);
+
+bool isTransportAddress(const std::string& address);
+
+#endif
@@ -1,70 +1,438 @@
 #include <homegear-base/BaseLib.h>
+#include "EepDescriptors.h"
+#include "DeviceDescriptions.h"
+#include "Trace.h"
+#include "Transport.h"
+#include "Metrics.h"
 #include <string>
 #include <iostream>
 #include <vector>
 #include <memory>
-
-std::shared_ptr<BaseLib::SerialReaderWriter> _serial;
+#include <sstream>
+#include <functional>
+#include <algorithm>
+#include <poll.h>
+#include <termios.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <random>
+#include <set>
+#include <atomic>
+#include <csignal>
+#include <fstream>
+#include <map>
+#include <sys/stat.h>
+#include <cstdlib>
+
+std::unique_ptr<Transport> _transport; // Connection to the USB 300, see createTransport()
+int32_t _transportTrack = 0; // Trace track of the USB 300, see "--trace"
 uint32_t _intAddress = 0;
 std::vector<char> _byteAddress;
-std::string _enoceanInterface;
-
-uint8_t crc8Table[256] = {
-	0x00, 0x07, 0x0e, 0x09, 0x1c, 0x1b, 0x12, 0x15,
-	0x38, 0x3f, 0x36, 0x31, 0x24, 0x23, 0x2a, 0x2d,
-	0x70, 0x77, 0x7e, 0x79, 0x6c, 0x6b, 0x62, 0x65,
-	0x48, 0x4f, 0x46, 0x41, 0x54, 0x53, 0x5a, 0x5d,
-	0xe0, 0xe7, 0xee, 0xe9, 0xfc, 0xfb, 0xf2, 0xf5,
-	0xd8, 0xdf, 0xd6, 0xd1, 0xc4, 0xc3, 0xca, 0xcd,
-	0x90, 0x97, 0x9e, 0x99, 0x8c, 0x8b, 0x82, 0x85,
-	0xa8, 0xaf, 0xa6, 0xa1, 0xb4, 0xb3, 0xba, 0xbd,
-	0xc7, 0xc0, 0xc9, 0xce, 0xdb, 0xdc, 0xd5, 0xd2,
-	0xff, 0xf8, 0xf1, 0xf6, 0xe3, 0xe4, 0xed, 0xea,
-	0xb7, 0xb0, 0xb9, 0xbe, 0xab, 0xac, 0xa5, 0xa2,
-	0x8f, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9d, 0x9a,
-	0x27, 0x20, 0x29, 0x2e, 0x3b, 0x3c, 0x35, 0x32,
-	0x1f, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0d, 0x0a,
-	0x57, 0x50, 0x59, 0x5e, 0x4b, 0x4c, 0x45, 0x42,
-	0x6f, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7d, 0x7a,
-	0x89, 0x8e, 0x87, 0x80, 0x95, 0x92, 0x9b, 0x9c,
-	0xb1, 0xb6, 0xbf, 0xb8, 0xad, 0xaa, 0xa3, 0xa4,
-	0xf9, 0xfe, 0xf7, 0xf0, 0xe5, 0xe2, 0xeb, 0xec,
-	0xc1, 0xc6, 0xcf, 0xc8, 0xdd, 0xda, 0xd3, 0xd4,
-	0x69, 0x6e, 0x67, 0x60, 0x75, 0x72, 0x7b, 0x7c,
-	0x51, 0x56, 0x5f, 0x58, 0x4d, 0x4a, 0x43, 0x44,
-	0x19, 0x1e, 0x17, 0x10, 0x05, 0x02, 0x0b, 0x0c,
-	0x21, 0x26, 0x2f, 0x28, 0x3d, 0x3a, 0x33, 0x34,
-	0x4e, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5c, 0x5b,
-	0x76, 0x71, 0x78, 0x7f, 0x6A, 0x6d, 0x64, 0x63,
-	0x3e, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2c, 0x2b,
-	0x06, 0x01, 0x08, 0x0f, 0x1a, 0x1d, 0x14, 0x13,
-	0xae, 0xa9, 0xa0, 0xa7, 0xb2, 0xb5, 0xbc, 0xbb,
-	0x96, 0x91, 0x98, 0x9f, 0x8a, 0x8D, 0x84, 0x83,
-	0xde, 0xd9, 0xd0, 0xd7, 0xc2, 0xc5, 0xcc, 0xcb,
-	0xe6, 0xe1, 0xe8, 0xef, 0xfa, 0xfd, 0xf4, 0xf3
+
+/**
+ * A Homegear installation the tests run against. Instance 0 is the default installation and the reference, others are
+ * added with "--compare" and see the same frames.
+ */
+struct HomegearInstance
+{
+	std::string configDirectory; // Passed with "-c", empty for the default
+	std::string interface; // Name of the EnOcean interface in its enocean.conf
+};
+std::vector<HomegearInstance> _instances;
+std::vector<char> _readBuffer;
+int32_t _maxPipelineDepth = 8;
+const uint32_t _addressCount = 128; // Size of the USB 300's base ID range, test peers only use sender IDs from it
+std::mutex _createdPeersMutex;
+std::set<std::pair<size_t, uint64_t>> _createdPeers; // Instance and ID of peers created and not yet deleted, see deleteCreatedPeers()
+volatile std::sig_atomic_t _terminate = 0; // Number of the received SIGINT or SIGTERM
+std::atomic<int32_t> _exitCode{0}; // Set by the first test that stops the run, see stopTests()
+
+/**
+ * Thrown to leave a test when the run stops because of a failed test or SIGINT/SIGTERM. Workers and RPC threads don't
+ * call exit() themselves: Peers would be deleted by deleteCreatedPeers() while other tests still use them. The
+ * exception unwinds to the worker, the remaining workers stop at their next checkTermination(), and main() exits once
+ * all of them are joined.
+ */
+class TestStop
+{
+};
+std::mutex _addressesMutex;
+std::vector<bool> _usedAddresses(_addressCount, false); // Sender IDs of the base ID range in use by test peers
+std::recursive_mutex _serialMutex;
+std::recursive_mutex _linkQualityMutex; // Also protects _stepLatencies
+int32_t _workerCount = 4;
+std::vector<std::string> _eepFilter; // When not empty, only these EEPs are tested
+
+/**
+ * Counting semaphore for resources shared by the test workers. A user can take the whole capacity for exclusive access.
+ * While such a user waits, no units are handed out to others, so it doesn't starve.
+ */
+class Resource
+{
+public:
+	explicit Resource(int32_t capacity) : _capacity(capacity), _available(capacity) {}
+
+	int32_t capacity()
+	{
+		std::lock_guard<std::mutex> resourceGuard(_mutex);
+		return _capacity;
+	}
+
+	void setCapacity(int32_t capacity)
+	{
+		std::lock_guard<std::mutex> resourceGuard(_mutex);
+		_available += capacity - _capacity;
+		_capacity = capacity;
+		_conditionVariable.notify_all();
+	}
+
+	void acquire(int32_t units)
+	{
+		std::unique_lock<std::mutex> resourceGuard(_mutex);
+		units = std::min(units, _capacity);
+		bool exclusive = units == _capacity;
+		if(exclusive) _exclusiveWaiting++;
+		_conditionVariable.wait(resourceGuard, [&]() { return _available >= units && (exclusive || _exclusiveWaiting == 0); });
+		if(exclusive) _exclusiveWaiting--;
+		_available -= units;
+	}
+
+	void release(int32_t units)
+	{
+		std::lock_guard<std::mutex> resourceGuard(_mutex);
+		_available += std::min(units, _capacity);
+		_conditionVariable.notify_all();
+	}
+private:
+	std::mutex _mutex;
+	std::condition_variable _conditionVariable;
+	int32_t _capacity;
+	int32_t _available;
+	int32_t _exclusiveWaiting = 0;
+};
+
+class ResourceGuard
+{
+public:
+	ResourceGuard(Resource& resource, int32_t units) : _resource(resource), _units(units) { _resource.acquire(_units); }
+	~ResourceGuard() { _resource.release(_units); }
+	ResourceGuard(const ResourceGuard&) = delete;
+	ResourceGuard& operator=(const ResourceGuard&) = delete;
+private:
+	Resource& _resource;
+	int32_t _units;
+};
+
+Resource _link(4); // One unit per test sending over the USB 300, tests waiting for frames from Homegear take all of them
+Resource _rpc(8); // Concurrent "homegear -e rc" processes
+int32_t _sampleSteps = 0; // When > 0, only about this many steps per pass are sent over the air
+int64_t _budget = 0; // Milliseconds available for the tests, 0 for no limit
+std::string _historyFilename("/var/tmp/homegear-enocean-tests.history");
+std::string _descriptionDirectory("/etc/homegear/devices/15");
+int32_t _oracleBatchSize = 4096;
+std::string _indexFilename("/var/tmp/homegear-enocean-tests.index"); // Binary index of the parsed device descriptions, empty to always parse
+
+struct LinkQuality
+{
+	int64_t frames = 0;
+	double rssi = 0; // Moving average in dBm
+	int32_t minRssi = 0;
+	int32_t maxRssi = -255;
+	int64_t steps = 0;
+	int64_t retries = 0;
+	int64_t lostFrames = 0; // Retries where the peer still reported the previous step's values
+	int64_t wrongValues = 0; // Retries where the peer reported values of neither step
+	double retryRate = 0; // Moving average of retries per step
+	int32_t successStreak = 0;
+	int32_t sendDelay = 50000; // Microseconds to wait after each frame
+	int32_t minSendDelay = 20000;
+	int32_t maxSendDelay = 250000;
+	int32_t weakRssi = -85;
+} _linkQuality;
+
+enum class FaultType : int32_t
+{
+	dataCrc,
+	headerCrc,
+	truncated,
+	wrongLength,
+	unknownRorg,
+	outOfRange,
+	count
+};
+const char* _faultTypeNames[] = { "data CRC", "header CRC", "truncated", "wrong length", "unknown RORG", "out of range" };
+
+double _faultRate = 0;
+bool _esp3Faults = false; // Only useful when the serial device is wired directly to Homegear's ESP3 parser
+std::vector<double> _faultRates;
+std::mt19937 _random(std::random_device{}());
+int64_t _faultsSent[(int32_t)FaultType::count] = {};
+std::vector<int64_t> _stepLatencies; // Milliseconds from sending a step's frame until its values were verified
+
+/**
+ * Live metrics of the run, see "--metrics" and monitor.cpp.
+ */
+struct TestMetrics
+{
+	explicit TestMetrics(int32_t workerCount);
+
+	std::atomic<int64_t>& framesSent;
+	std::atomic<int64_t>& framesReceived;
+	std::atomic<int64_t>& steps;
+	std::atomic<int64_t>& retries;
+	std::atomic<int64_t>& lostFrames;
+	std::atomic<int64_t>& wrongValues;
+	std::atomic<int64_t>& tests;
+	std::atomic<int64_t>& sendDelay;
+	std::atomic<int64_t>& dutyCycleHeadroom;
+	std::atomic<int64_t>& rssi;
+	MetricsHistogram& rpcLatency;
+	MetricsHistogram& stepLatency;
+	std::vector<MetricsText*> workerSteps;
+};
+std::unique_ptr<TestMetrics> _metrics;
+thread_local MetricsText* _workerStep = nullptr; // Current test and step of the calling worker
+
+/**
+ * Results of one EEP on one Homegear instance in "--compare" mode.
+ */
+struct InstanceResult
+{
+	std::vector<int64_t> latencies; // Microseconds from sending a step's frame until the instance returned its values
+	int64_t differences = 0; // Steps with values other than the reference instance's
+	std::vector<std::string> examples; // The first differences
 };
 
+std::mutex _comparisonMutex;
+std::map<std::string, std::vector<InstanceResult>> _comparison; // By EEP, one entry per instance
+
+enum class DeviationKind : int32_t
+{
+	lostFrame, // Retried, the peer still reported the previous values
+	wrongValue, // Retried, a value was outside its tolerance
+	tolerated, // Accepted, a value was off but within its tolerance
+	otherInstance // Retried, another instance returned other values, see "--compare"
+};
+
+/**
+ * One retried attempt or accepted deviation of a step. Value deviations are stored per field, lost frames and retries
+ * of checks once per attempt with an empty variable.
+ */
+struct Deviation
+{
+	std::string eep;
+	std::string variable;
+	DeviationKind kind = DeviationKind::lostFrame;
+	int32_t raw = 0; // Sent raw value
+	int32_t region = -1; // Eighth of the field's raw range raw is in, -1 without variable
+	int32_t field = -1; // Index of variable in the EEP's fields, -1 without variable
+	int32_t deviation = 0; // Raw units read back minus raw, 1 or -1 for boolean fields, 0 for retries
+	int32_t attempt = 1;
+	int64_t latency = 0; // Milliseconds from sending the frame until the values were read
+	int32_t rssi = 0; // Moving average of the link in dBm, 0 while nothing was received
+	int64_t time = 0;
+};
+
+std::mutex _deviationsMutex;
+std::vector<Deviation> _deviations;
+std::map<std::string, std::vector<int64_t>> _verifiedRegions; // By EEP and variable, verified steps per raw region
+std::string _deviationsFilename; // See "--deviations"
+std::ofstream _deviationsFile; // Opened on the first record, guarded by _deviationsMutex
+
 void sendPacket(std::vector<char> data);
-std::vector<char> readPacket();
+void writePacket(const std::vector<char>& data);
+void sendFaults(uint32_t address);
+std::vector<char> getRadioPacket(const std::vector<char>& data);
+std::vector<char> getRadioPacket(const std::vector<char>& data, uint32_t address);
+std::vector<char> getTeachInPacket(std::string eep, uint32_t address);
+std::vector<char> getEepData(const EepDescriptor& descriptor, const std::vector<uint8_t>& data);
+void testEep(const std::string& eep);
+void testEep(const EepDescriptor& descriptor);
+void testEep(const EepDescriptor& descriptor, int32_t sampleSteps);
+int32_t getSampleStride(const EepPass& pass, int32_t sampleSteps);
+int64_t getFrameCount(const EepDescriptor& descriptor, int32_t sampleSteps);
+std::vector<char> readPacket(int64_t deadline);
+std::vector<char> waitForPacket(std::function<bool(const std::vector<char>&)> predicate, int64_t deadline);
+void flushInput();
+void recordReceivedPacket(const std::vector<char>& packet);
+void recordStep(bool success, bool frameLost);
+void updateSendDelayMetrics();
+bool isLinkWeak();
+int32_t getRetryBudget();
+void printLinkQuality();
+void recordComparison(const std::string& eep, const std::string& step, const std::vector<std::string>& variables, const std::vector<std::vector<double>>& values, const std::vector<int64_t>& latencies);
+void printComparison();
+int32_t getRawRegion(const EepField& field, int32_t raw);
+void recordDeviation(Deviation deviation);
+void recordVerifiedStep(const EepDescriptor& descriptor, const EepPass& pass, int32_t index);
+void printDeviations();
 void getAddress();
 uint64_t createDevice(std::string eep);
-void deleteDevice(uint64_t peerId);
+uint64_t createDevice(std::string eep, uint32_t address, size_t instance = 0);
+void deleteDevice(uint64_t peerId, size_t instance = 0);
+void deleteCreatedPeers();
+void deleteLeftoverPeers();
+void handleSignal(int signalNumber);
+void checkTermination();
+void setExitCode(int32_t exitCode);
+[[noreturn]] void stopTests(int32_t exitCode);
+uint32_t acquireAddress();
+void releaseAddress(uint32_t address);
+std::string getRpcCommand(const std::string& script, size_t instance);
+void execRpc(const std::string& script, std::string& output, size_t instance = 0);
+
+/**
+ * Owns a peer created for a test on every Homegear instance together with its sender ID from the base ID range and
+ * deletes it when going out of scope, also while a TestStop unwinds. Peers whose deletion failed are deleted by
+ * deleteCreatedPeers() instead.
+ */
+class TestPeer
+{
+public:
+	TestPeer() {}
+	explicit TestPeer(std::string eep) : _address(acquireAddress())
+	{
+		for(size_t i = 0; i < _instances.size(); i++) _ids.push_back(createDevice(eep, _address, i));
+	}
+	TestPeer(TestPeer&& other) : _address(other._address), _ids(std::move(other._ids))
+	{
+		other._address = 0;
+		other._ids.clear();
+	}
+	TestPeer(const TestPeer&) = delete;
+	TestPeer& operator=(const TestPeer&) = delete;
+	TestPeer& operator=(TestPeer&& other)
+	{
+		if(this == &other) return *this;
+		reset();
+		_address = other._address;
+		_ids = std::move(other._ids);
+		other._address = 0;
+		other._ids.clear();
+		return *this;
+	}
+	~TestPeer() { reset(); }
+
+	uint32_t address() const { return _address; }
+	uint64_t id() const { return _ids.empty() ? 0 : _ids.front(); }
+	uint64_t id(size_t instance) const { return _ids.at(instance); }
+
+	void reset()
+	{
+		for(size_t i = 0; i < _ids.size(); i++) deleteDevice(_ids[i], i);
+		if(_address != 0) releaseAddress(_address);
+		_ids.clear();
+		_address = 0;
+	}
+private:
+	uint32_t _address = 0;
+	std::vector<uint64_t> _ids; // By instance
+};
+
+struct TestTask
+{
+	std::string name;
+	int32_t linkUnits; // Units of _link needed while running
+	int32_t priority; // Tests with higher priority are planned and run first
+	std::vector<int64_t> costs; // Estimated milliseconds per coverage level, from the cheapest to full coverage
+	std::function<void(size_t)> run; // Runs the test with the given coverage level
+	size_t level;
+};
+
+/**
+ * Timing and outcome of the last runs of one test, stored in _historyFilename.
+ */
+struct TestHistory
+{
+	double millisecondsPerFrame = 0;
+	int64_t lastStart = 0;
+	int64_t lastSuccess = 0;
+};
+
+std::mutex _historyMutex;
+std::map<std::string, TestHistory> _history;
+
+/**
+ * Runs independent tests on worker threads. Every worker has its own deque and takes its next test from the back.
+ * A worker whose deque is empty steals from the front of the other workers' deques, so the remaining tests are spread
+ * over all workers until everything is done.
+ */
+class TestRunner
+{
+public:
+	explicit TestRunner(int32_t workerCount);
+
+	void add(TestTask task);
+	void plan(int64_t budget);
+	void run();
+private:
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<TestTask> tasks;
+		std::thread thread;
+	};
+
+	std::vector<TestTask> _tasks;
+	std::vector<std::unique_ptr<Worker>> _workers;
+	std::mutex _resultsMutex;
+	std::vector<std::pair<std::string, int64_t>> _durations;
+
+	bool getTask(size_t workerIndex, TestTask& task);
+	void work(size_t workerIndex);
+};
+
 int64_t getIntValue(uint64_t peerId, int32_t channel, std::string variable);
 bool getBooleanValue(uint64_t peerId, int32_t channel, std::string variable);
 double getDoubleValue(uint64_t peerId, int32_t channel, std::string variable);
+std::vector<BaseLib::PVariable> getValues(uint64_t peerId, int32_t channel, std::vector<std::string> variables, size_t instance = 0);
+double toDouble(const BaseLib::PVariable& value);
+std::vector<double> getDoubleValues(uint64_t peerId, int32_t channel, std::vector<std::string> variables, size_t instance = 0);
+std::vector<std::vector<double>> getInstanceValues(const TestPeer& peer, int32_t channel, const std::vector<std::string>& variables, int64_t sendTime, std::vector<int64_t>& latencies);
+bool teachIn(const TestPeer& peer, std::string eep, std::vector<char> data, std::vector<std::string> variables, std::vector<double> expectedValues);
 void setValue(uint64_t peerId, int32_t channel, std::string variable, bool value);
 void setValue(uint64_t peerId, int32_t channel, std::string variable, int32_t value);
 void runTests();
-void testF6();
-void testD5();
-void testA5();
-void testD2();
+void addEepTest(TestRunner& runner, const std::string& eep);
+void addLinkTest(TestRunner& runner, const std::string& eep, int64_t cost, void (*test)());
+void loadHistory();
+void saveHistory();
+void recordTestStart(const std::string& name);
+void recordTestSuccess(const std::string& name, int64_t duration, int64_t frames);
+int32_t getTestPriority(const std::string& name, const std::map<std::string, int64_t>& descriptionTimes);
+std::map<std::string, int64_t> getDescriptionTimes();
+void testF6(TestRunner& runner);
+void testD5(TestRunner& runner);
+void testA53801();
+void testA53802();
+void testA5(TestRunner& runner);
+void testD2(TestRunner& runner);
+void testFaults();
+int32_t testOracle(const std::string& directory);
 
 void printHelp()
 {
-	std::cout << "Usage: homegear-enocean-tests SERIALDEVICE INTERFACENAME" << std::endl;
-	std::cout << "  SERIALDEVICE:   The device name of the USB 300 used for sending test packets (Example: \"/dev/ttyUSB0\")" << std::endl;
+	std::cout << "Usage: homegear-enocean-tests GATEWAY INTERFACENAME [OPTIONS]" << std::endl;
+	std::cout << "       homegear-enocean-tests --oracle [DIRECTORY] [--index FILE]" << std::endl;
+	std::cout << "  GATEWAY:        The USB 300 used for sending test packets. Either a serial device (Example: \"/dev/ttyUSB0\"), a TCP bridge like ser2net (Example: \"tcp://192.168.0.20:3000\", append \"?nodelay=0\" to turn off TCP_NODELAY) or \"loopback[:PORT]\" for a local stand-in" << std::endl;
 	std::cout << "  INTERFACENAME:  The name of the USB 300 used by Homegear as defined in \"/etc/homegear/families/enocean.conf\" (Example: \"My-EnOcean-Interface\")" << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << "  --faults RATES: Instead of the normal tests run one sweep per comma separated fault rate with faulty frames mixed in and report throughput and latency (Example: \"0,0.1,0.5\")" << std::endl;
+	std::cout << "  --esp3-faults:  Also send frames with bad CRCs or truncated frames. Only useful when GATEWAY is wired directly to Homegear's interface." << std::endl;
+	std::cout << "  --workers N:    Number of EEP tests run in parallel (default: 4)" << std::endl;
+	std::cout << "  --rpc-slots N:  Maximum number of concurrent Homegear RPC calls (default: 8)" << std::endl;
+	std::cout << "  --budget TIME:  Plan the tests to take about TIME (Example: \"600\", \"10m\", \"2h\"). Coverage and order are chosen from the timing of earlier runs. Failed tests and EEPs with changed device descriptions come first." << std::endl;
+	std::cout << "  --compare CONFIGDIR INTERFACENAME: Also verify every step on the Homegear instance started with \"-c CONFIGDIR\". Its EnOcean interface INTERFACENAME must receive the same frames. Prints a per EEP comparison of values and latencies at the end." << std::endl;
+	std::cout << "  --trace FILE:   Write a timeline of the run for Perfetto or chrome://tracing" << std::endl;
+	std::cout << "  --metrics FILE: Publish live counters (frames, steps, retries, send delay, RPC latency, current step of each worker) to FILE while running. Read them with \"monitor FILE\"." << std::endl;
+	std::cout << "  --deviations FILE: Append every retry and tolerated deviation (time, EEP, variable, kind, raw value, offset, attempt, latency in ms, RSSI) to FILE" << std::endl;
+	std::cout << "  --history FILE: Timing and results of earlier runs (default: \"/var/tmp/homegear-enocean-tests.history\")" << std::endl;
+	std::cout << "  --eeps LIST:    Only test the comma separated EEPs (Example: \"A50201,A50701\")" << std::endl;
+	std::cout << "  --sample STEPS: Only send about STEPS evenly spaced steps per pass including both ends, e.g. after the conversions were verified with --oracle." << std::endl;
+	std::cout << "  --oracle:       Don't send anything. Check the conversions of Homegear's device descriptions in DIRECTORY (default: \"/etc/homegear/devices/15\") against the EEP descriptors for every raw value." << std::endl;
+	std::cout << "  --index FILE:   Binary index of the parsed device descriptions used by --oracle and --budget (default: \"/var/tmp/homegear-enocean-tests.index\"). Pass \"\" to always parse the XML files." << std::endl;
 }
 
 void getAddress()
@@ -72,11 +440,9 @@ void getAddress()
 	std::vector<char> packet{ 0x55, 0x00, 0x01, 0x00, 0x05, 0x00, 0x08, 0x00 };
 	sendPacket(packet);
 
-	int64_t startTime = BaseLib::HelperFunctions::getTime();
-	while(BaseLib::HelperFunctions::getTime() < startTime + 2000)
+	packet = waitForPacket([](const std::vector<char>& response) { return response.size() == 13 && response[4] == 2 && response[1] == 0 && response[2] == 5 && response[3] == 1 && response[6] == 0; }, BaseLib::HelperFunctions::getTime() + 2000);
+	if(!packet.empty())
 	{
-		packet = readPacket();
-		if(packet.size() != 13 || packet[4] != 2 || packet[1] != 0 || packet[2] != 5 || packet[3] != 1 || packet[6] != 0) continue;
 		_intAddress = ((uint32_t)(uint8_t)packet[7] << 24) | ((uint32_t)(uint8_t)packet[8] << 16) | ((uint32_t)(uint8_t)packet[9] << 8) | (uint8_t)packet[10];
 		_byteAddress.resize(4);
 		_byteAddress[0] = packet[7];
@@ -84,56 +450,204 @@ void getAddress()
 		_byteAddress[2] = packet[9];
 		_byteAddress[3] = packet[10];
 		std::cout << "EnOcean address is: " << BaseLib::HelperFunctions::getHexString(_byteAddress) << std::endl;
-		break;
 	}
 	if(_intAddress == 0)
 	{
 		std::cerr << "Could not get EnOcean address from USB 300." << std::endl;
-		exit(1);
+		stopTests(1);
 	}
 }
 
 uint64_t createDevice(std::string eep)
+{
+	return createDevice(eep, _intAddress);
+}
+
+uint64_t createDevice(std::string eep, uint32_t address, size_t instance)
 {
 	std::cout << "Creating device with EEP \"" + eep + "\"... ";
 	std::string output;
-	BaseLib::HelperFunctions::exec("homegear -e rc 'print($hg->createDevice(15, (int)hexdec(\"" + eep + "\"), \"\", (int)" + std::to_string(_intAddress) + ", 0, \"" + _enoceanInterface + "\"));'", output);
+	execRpc("print($hg->createDevice(15, (int)hexdec(\"" + eep + "\"), \"\", (int)" + std::to_string(address) + ", 0, \"" + _instances.at(instance).interface + "\"));", output, instance);
 	if(output.find("HomegearException") != std::string::npos)
 	{
 		std::cerr << "Could not create device. HomegearException thrown: " << output << std::endl;
-		exit(1);
+		stopTests(1);
 	}
 	uint64_t peerId = BaseLib::Math::getNumber(output);
 	if(peerId == 0)
 	{
 		std::cerr << "Could not create device. Returned peer ID is invalid." << std::endl;
-		exit(1);
+		stopTests(1);
 	}
 	std::cout << "ID: " << peerId << std::endl;
+	std::lock_guard<std::mutex> createdPeersGuard(_createdPeersMutex);
+	_createdPeers.insert(std::make_pair(instance, peerId));
 	return peerId;
 }
 
-void deleteDevice(uint64_t peerId)
+void deleteDevice(uint64_t peerId, size_t instance)
 {
 	std::cout << "Removing device ... ";
 	std::string output;
-	BaseLib::HelperFunctions::exec("homegear -e rc '$hg->deleteDevice((int)" + std::to_string(peerId) + ", 0);'", output);
+	execRpc("$hg->deleteDevice((int)" + std::to_string(peerId) + ", 0);", output, instance);
 	if(output.find("HomegearException") != std::string::npos)
 	{
+		// Called from destructors while a stopped test unwinds, so no TestStop here. deleteCreatedPeers() tries again.
 		std::cerr << "Could not delete device. HomegearException thrown: " << output << std::endl;
-		exit(1);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> createdPeersGuard(_createdPeersMutex);
+		_createdPeers.erase(std::make_pair(instance, peerId));
 	}
 	std::cout << "ok" << std::endl;
 }
 
+/**
+ * Registered with atexit(), so peers are deleted on every exit path including stopped runs. main() only exits once all
+ * workers are joined, so no test uses the peers anymore. All remaining peers are deleted in one call.
+ */
+void deleteCreatedPeers()
+{
+	std::set<std::pair<size_t, uint64_t>> peers;
+	{
+		std::lock_guard<std::mutex> createdPeersGuard(_createdPeersMutex);
+		peers.swap(_createdPeers);
+	}
+	if(peers.empty()) return;
+
+	std::cout << "Removing " << peers.size() << " remaining devices... ";
+	bool success = true;
+	for(size_t instance = 0; instance < _instances.size(); instance++)
+	{
+		std::string ids;
+		for(auto& peer : peers)
+		{
+			if(peer.first == instance) ids += (ids.empty() ? "" : ", ") + std::to_string(peer.second);
+		}
+		if(ids.empty()) continue;
+		std::string output;
+		BaseLib::HelperFunctions::exec(getRpcCommand("foreach([" + ids + "] as $peerId) $hg->deleteDevice($peerId, 0);", instance), output);
+		if(output.find("HomegearException") == std::string::npos) continue;
+		std::cerr << "Could not delete devices " << ids << ". HomegearException thrown: " << output << std::endl;
+		success = false;
+	}
+	if(success) std::cout << "ok" << std::endl;
+}
+
+/**
+ * Deletes EnOcean peers using a sender ID from our base ID range. Such peers can only be left over from earlier runs
+ * that were killed before they could clean up. All of them are found and deleted in one call.
+ */
+void deleteLeftoverPeers()
+{
+	for(size_t instance = 0; instance < _instances.size(); instance++)
+	{
+		std::string output;
+		BaseLib::HelperFunctions::exec(getRpcCommand("$count = 0; for($address = " + std::to_string(_intAddress) + "; $address < " + std::to_string((uint64_t)_intAddress + _addressCount) + "; $address++) { foreach($hg->getPeerId(2, $address) as $peerId) { if($hg->getDeviceInfo($peerId, [\"FAMILY\"])[\"FAMILY\"] != 15) continue; $hg->deleteDevice($peerId, 0); $count++; } } print($count);", instance), output);
+		if(output.find("HomegearException") != std::string::npos)
+		{
+			std::cerr << "Could not delete devices left over from earlier runs. HomegearException thrown: " << output << std::endl;
+			continue;
+		}
+		int64_t count = BaseLib::Math::getNumber(output);
+		if(count > 0) std::cout << "Removed " << count << " devices left over from earlier runs." << std::endl;
+	}
+}
+
+void handleSignal(int signalNumber)
+{
+	_terminate = signalNumber;
+}
+
+/**
+ * Throws TestStop if SIGINT or SIGTERM was received or another test stopped the run.
+ */
+void checkTermination()
+{
+	if(_terminate != 0)
+	{
+		int32_t exitCode = 0;
+		if(_exitCode.compare_exchange_strong(exitCode, 128 + _terminate)) std::cerr << std::endl << "Interrupted." << std::endl;
+		throw TestStop();
+	}
+	if(_exitCode != 0) throw TestStop();
+}
+
+/**
+ * Sets the exit code unless the run is already stopping. Threads which can't unwind into a worker, e. g. after catching
+ * an exception, call this and let the next checkTermination() throw.
+ */
+void setExitCode(int32_t exitCode)
+{
+	int32_t expected = 0;
+	_exitCode.compare_exchange_strong(expected, exitCode);
+}
+
+/**
+ * Stops the run with exitCode unless it is already stopping. Called instead of exit() after errors, see TestStop.
+ */
+void stopTests(int32_t exitCode)
+{
+	setExitCode(exitCode);
+	throw TestStop();
+}
+
+/**
+ * Returns a free sender ID from the base ID range.
+ */
+uint32_t acquireAddress()
+{
+	std::lock_guard<std::mutex> addressesGuard(_addressesMutex);
+	for(uint32_t i = 0; i < _addressCount; i++)
+	{
+		if(_usedAddresses[i]) continue;
+		_usedAddresses[i] = true;
+		return _intAddress + i;
+	}
+	std::cerr << "No free sender ID left in the base ID range." << std::endl;
+	stopTests(1);
+}
+
+void releaseAddress(uint32_t address)
+{
+	std::lock_guard<std::mutex> addressesGuard(_addressesMutex);
+	if(address >= _intAddress && address - _intAddress < _addressCount) _usedAddresses[address - _intAddress] = false;
+}
+
+/**
+ * Command line running script in Homegear's script engine on the given instance. Scripts must not contain single
+ * quotes.
+ */
+std::string getRpcCommand(const std::string& script, size_t instance)
+{
+	const std::string& configDirectory = _instances.at(instance).configDirectory;
+	return "homegear " + (configDirectory.empty() ? std::string() : "-c " + configDirectory + " ") + "-e rc '" + script + "'";
+}
+
+void execRpc(const std::string& script, std::string& output, size_t instance)
+{
+	std::string method;
+	if(isTracing())
+	{
+		size_t methodStart = script.find("$hg->");
+		if(methodStart != std::string::npos) method = script.substr(methodStart + 5, script.find('(', methodStart) - methodStart - 5);
+	}
+	TraceSpan rpcSpan("RPC", method);
+	ResourceGuard rpcGuard(_rpc, 1);
+	int64_t startTime = BaseLib::HelperFunctions::getTimeMicroseconds();
+	BaseLib::HelperFunctions::exec(getRpcCommand(script, instance), output);
+	_metrics->rpcLatency.observe(BaseLib::HelperFunctions::getTimeMicroseconds() - startTime);
+}
+
 int64_t getIntValue(uint64_t peerId, int32_t channel, std::string variable)
 {
 	std::string output;
-	BaseLib::HelperFunctions::exec("homegear -e rc 'print($hg->getValue((int)" + std::to_string(peerId) + ", (int)" + std::to_string(channel) + ", \"" + variable + "\"));'", output);
+	execRpc("print($hg->getValue((int)" + std::to_string(peerId) + ", (int)" + std::to_string(channel) + ", \"" + variable + "\"));", output);
 	if(output.find("HomegearException") != std::string::npos)
 	{
 		std::cerr << "Could not get value of variable \"" + variable + "\" for peer \"" + std::to_string(peerId) + "\" on channel \"" + std::to_string(channel) + "\". HomegearException thrown: " << output << std::endl;
-		exit(1);
+		stopTests(1);
 	}
 	return BaseLib::Math::getNumber(output);
 }
@@ -141,11 +655,11 @@ int64_t getIntValue(uint64_t peerId, int32_t channel, std::string variable)
 bool getBooleanValue(uint64_t peerId, int32_t channel, std::string variable)
 {
 	std::string output;
-	BaseLib::HelperFunctions::exec("homegear -e rc 'print($hg->getValue((int)" + std::to_string(peerId) + ", (int)" + std::to_string(channel) + ", \"" + variable + "\"));'", output);
+	execRpc("print($hg->getValue((int)" + std::to_string(peerId) + ", (int)" + std::to_string(channel) + ", \"" + variable + "\"));", output);
 	if(output.find("HomegearException") != std::string::npos)
 	{
 		std::cerr << "Could not get value of variable \"" + variable + "\" for peer \"" + std::to_string(peerId) + "\" on channel \"" + std::to_string(channel) + "\". HomegearException thrown: " << output << std::endl;
-		exit(1);
+		stopTests(1);
 	}
 	return output == "true" || output == "1";
 }
@@ -153,951 +667,1800 @@ bool getBooleanValue(uint64_t peerId, int32_t channel, std::string variable)
 double getDoubleValue(uint64_t peerId, int32_t channel, std::string variable)
 {
 	std::string output;
-	BaseLib::HelperFunctions::exec("homegear -e rc 'print($hg->getValue((int)" + std::to_string(peerId) + ", (int)" + std::to_string(channel) + ", \"" + variable + "\"));'", output);
+	execRpc("print($hg->getValue((int)" + std::to_string(peerId) + ", (int)" + std::to_string(channel) + ", \"" + variable + "\"));", output);
 	if(output.find("HomegearException") != std::string::npos)
 	{
 		std::cerr << "Could not get value of variable \"" + variable + "\" for peer \"" + std::to_string(peerId) + "\" on channel \"" + std::to_string(channel) + "\". HomegearException thrown: " << output << std::endl;
-		exit(1);
+		stopTests(1);
 	}
 	return BaseLib::Math::getDouble(output);
 }
 
+/**
+ * Reads all given variables of a channel with one getParamset call and returns them in the order of "variables".
+ * Variables missing in the paramset are returned as void.
+ */
+std::vector<BaseLib::PVariable> getValues(uint64_t peerId, int32_t channel, std::vector<std::string> variables, size_t instance)
+{
+	std::string keys;
+	for(auto& variable : variables)
+	{
+		keys += (keys.empty() ? "\"" : ", \"") + variable + "\"";
+	}
+	std::string output;
+	execRpc("$values = $hg->getParamset((int)" + std::to_string(peerId) + ", (int)" + std::to_string(channel) + ", \"VALUES\"); foreach([" + keys + "] as $key) { $value = $values[$key] ?? null; if(is_bool($value)) print(\"b\".($value ? 1 : 0).\"\\n\"); else if(is_int($value)) print(\"i$value\\n\"); else if(is_float($value)) print(\"f$value\\n\"); else if(is_null($value)) print(\"v\\n\"); else print(\"s$value\\n\"); }", output, instance);
+	if(output.find("HomegearException") != std::string::npos)
+	{
+		std::cerr << "Could not get values for peer \"" + std::to_string(peerId) + "\" on channel \"" + std::to_string(channel) + "\". HomegearException thrown: " << output << std::endl;
+		stopTests(1);
+	}
+
+	std::vector<BaseLib::PVariable> values;
+	values.reserve(variables.size());
+	std::istringstream stream(output);
+	std::string line;
+	while(values.size() < variables.size() && std::getline(stream, line))
+	{
+		if(line.empty()) continue;
+		std::string value = line.substr(1);
+		switch(line.front())
+		{
+			case 'b':
+				values.push_back(std::make_shared<BaseLib::Variable>(value == "1"));
+				break;
+			case 'i':
+				values.push_back(std::make_shared<BaseLib::Variable>((int32_t)BaseLib::Math::getNumber(value)));
+				break;
+			case 'f':
+				values.push_back(std::make_shared<BaseLib::Variable>(BaseLib::Math::getDouble(value)));
+				break;
+			case 's':
+				values.push_back(std::make_shared<BaseLib::Variable>(value));
+				break;
+			default:
+				values.push_back(std::make_shared<BaseLib::Variable>());
+				break;
+		}
+	}
+	while(values.size() < variables.size()) values.push_back(std::make_shared<BaseLib::Variable>());
+	return values;
+}
+
+double toDouble(const BaseLib::PVariable& value)
+{
+	switch(value->type)
+	{
+		case BaseLib::VariableType::tBoolean:
+			return value->booleanValue;
+		case BaseLib::VariableType::tInteger:
+			return value->integerValue;
+		case BaseLib::VariableType::tFloat:
+			return value->floatValue;
+		case BaseLib::VariableType::tString:
+			return BaseLib::Math::getDouble(value->stringValue);
+		default:
+			return 0;
+	}
+}
+
+std::vector<double> getDoubleValues(uint64_t peerId, int32_t channel, std::vector<std::string> variables, size_t instance)
+{
+	std::vector<BaseLib::PVariable> values = getValues(peerId, channel, variables, instance);
+	std::vector<double> doubleValues;
+	doubleValues.reserve(values.size());
+	for(auto& value : values) doubleValues.push_back(toDouble(value));
+	return doubleValues;
+}
+
+/**
+ * Reads the variables from the peer on all Homegear instances at the same time. latencies receives the microseconds
+ * from sendTime (as returned by getTimeMicroseconds()) until each instance answered.
+ */
+std::vector<std::vector<double>> getInstanceValues(const TestPeer& peer, int32_t channel, const std::vector<std::string>& variables, int64_t sendTime, std::vector<int64_t>& latencies)
+{
+	std::vector<std::vector<double>> values(_instances.size());
+	latencies.assign(_instances.size(), 0);
+	std::atomic<bool> stopped(false);
+	auto getValues = [&](size_t instance)
+	{
+		try
+		{
+			values[instance] = getDoubleValues(peer.id(instance), channel, variables, instance);
+			latencies[instance] = BaseLib::HelperFunctions::getTimeMicroseconds() - sendTime;
+		}
+		catch(TestStop&)
+		{
+			stopped = true;
+		}
+		catch(BaseLib::Exception& ex)
+		{
+			std::cerr << ex.what() << std::endl;
+			setExitCode(1);
+			stopped = true;
+		}
+		catch(std::exception& ex)
+		{
+			std::cerr << ex.what() << std::endl;
+			setExitCode(1);
+			stopped = true;
+		}
+	};
+	std::vector<std::thread> threads;
+	for(size_t i = 1; i < _instances.size(); i++) threads.push_back(std::thread(getValues, i));
+	getValues(0);
+	for(auto& thread : threads) thread.join();
+	if(stopped) throw TestStop();
+	return values;
+}
+
 void setValue(uint64_t peerId, int32_t channel, std::string variable, bool value)
 {
 	std::string output;
-	BaseLib::HelperFunctions::exec("homegear -e rc '$hg->setValue((int)" + std::to_string(peerId) + ", (int)" + std::to_string(channel) + ", \"" + variable + "\", (bool)" + std::to_string(value) + ");'", output);
+	execRpc("$hg->setValue((int)" + std::to_string(peerId) + ", (int)" + std::to_string(channel) + ", \"" + variable + "\", (bool)" + std::to_string(value) + ");", output);
 	if(output.find("HomegearException") != std::string::npos)
 	{
 		std::cerr << "Could not set value of variable \"" + variable + "\" for peer \"" + std::to_string(peerId) + "\" on channel \"" + std::to_string(channel) + "\". HomegearException thrown: " << output << std::endl;
-		exit(1);
+		stopTests(1);
 	}
 }
 
 void setValue(uint64_t peerId, int32_t channel, std::string variable, int32_t value)
 {
 	std::string output;
-	BaseLib::HelperFunctions::exec("homegear -e rc '$hg->setValue((int)" + std::to_string(peerId) + ", (int)" + std::to_string(channel) + ", \"" + variable + "\", (int)" + std::to_string(value) + ");'", output);
+	execRpc("$hg->setValue((int)" + std::to_string(peerId) + ", (int)" + std::to_string(channel) + ", \"" + variable + "\", (int)" + std::to_string(value) + ");", output);
 	if(output.find("HomegearException") != std::string::npos)
 	{
 		std::cerr << "Could not set value of variable \"" + variable + "\" for peer \"" + std::to_string(peerId) + "\" on channel \"" + std::to_string(channel) + "\". HomegearException thrown: " << output << std::endl;
-		exit(1);
+		stopTests(1);
 	}
 }
 
-std::vector<char> readPacket()
+/**
+ * Returns the next complete ESP3 packet or an empty vector when the deadline (in milliseconds as returned by getTime())
+ * passes. Blocks in poll() while waiting, so no CPU time is spent on idle links.
+ */
+std::vector<char> readPacket(int64_t deadline)
 {
-	int64_t startTime = BaseLib::HelperFunctions::getTime();
-	std::vector<char> packet;
-	uint32_t size = 0;
-	while(BaseLib::HelperFunctions::getTime() < startTime + 2000)
+	std::lock_guard<std::recursive_mutex> serialGuard(_serialMutex);
+	while(true)
 	{
-		char data;
-		int32_t result = _serial->readChar(data, 5000000);
+		// {{{ Extract packet from buffer
+			std::vector<char>::iterator start = std::find(_readBuffer.begin(), _readBuffer.end(), 0x55);
+			if(start != _readBuffer.begin()) _readBuffer.erase(_readBuffer.begin(), start);
+			if(_readBuffer.size() >= 6)
+			{
+				if(getCrc8(_readBuffer.data() + 1, 4) != (uint8_t)_readBuffer[5])
+				{
+					_readBuffer.erase(_readBuffer.begin()); // Not a header, resynchronize on the next sync byte
+					continue;
+				}
+				uint32_t size = (((uint32_t)(uint8_t)_readBuffer[1] << 8) | (uint8_t)_readBuffer[2]) + (uint8_t)_readBuffer[3] + 7;
+				if(_readBuffer.size() >= size)
+				{
+					std::vector<char> packet(_readBuffer.begin(), _readBuffer.begin() + size);
+					_readBuffer.erase(_readBuffer.begin(), _readBuffer.begin() + size);
+					recordReceivedPacket(packet);
+					return packet;
+				}
+			}
+		// }}}
+
+		int64_t timeout = std::max((int64_t)0, deadline - BaseLib::HelperFunctions::getTime());
+
+		pollfd pollInfo{ _transport->fileDescriptor(), POLLIN, 0 };
+		int32_t result = poll(&pollInfo, 1, (int32_t)timeout);
 		if(result == -1)
 		{
+			if(errno == EINTR) continue;
 			std::cerr << "Error" << std::endl;
-			exit(1);
+			stopTests(1);
 		}
-		else if(result == 1)
+		else if(result == 0) return std::vector<char>();
+
+		char buffer[1024];
+		ssize_t bytesRead = _transport->read(buffer, sizeof(buffer));
+		if(bytesRead == 0) continue;
+		else if(bytesRead < 0)
 		{
-			size = 0;
-			packet.clear();
-			continue;
+			std::cerr << "Error" << std::endl;
+			stopTests(1);
 		}
-
-		if(packet.empty() && data != 0x55) continue;
-
-		packet.push_back(data);
-		if(size == 0 && packet.size() == 6) size = ((packet[1] << 8) | packet[2]) + packet[3] + 7;
-		if(size > 0 && packet.size() == size) return packet;
+		_readBuffer.insert(_readBuffer.end(), buffer, buffer + bytesRead);
 	}
-	return packet;
 }
 
-void sendPacket(std::vector<char> data)
+std::vector<char> waitForPacket(std::function<bool(const std::vector<char>&)> predicate, int64_t deadline)
 {
-	uint8_t crc8 = 0;
-	for(int32_t i = 1; i < 5; i++)
-	{
-		crc8 = crc8Table[crc8 ^ (uint8_t)data[i]];
-	}
-	data[5] = crc8;
-
-	crc8 = 0;
-	for(int32_t i = 6; i < data.size() - 1; i++)
+	while(true)
 	{
-		crc8 = crc8Table[crc8 ^ (uint8_t)data[i]];
+		checkTermination();
+		std::vector<char> packet = readPacket(deadline);
+		if(packet.empty() || predicate(packet)) return packet;
 	}
-	data.back() = crc8;
-
-	_serial->closeDevice(); // Reconnect to avoid duty cycle limit
-	_serial->openDevice(false, false, false);
-	_serial->writeData(data);
+}
 
-	usleep(50000);
+/**
+ * Discards everything received so far, both in the kernel's input queue and in our own buffer.
+ */
+void flushInput()
+{
+	std::lock_guard<std::recursive_mutex> serialGuard(_serialMutex);
+	_transport->flushInput();
+	_readBuffer.clear();
 }
 
-int main(int argc, char* argv[])
+void sendPacket(std::vector<char> data)
 {
-	if(argc < 3)
-	{
-		printHelp();
-		exit(1);
-	}
-	
-	std::string serialDevice(argv[1]);
-	if(serialDevice.find('/') == std::string::npos)
-	{
-		std::cerr << "Invalid serial device." << std::endl;
-		printHelp();
-		exit(1);
-	}
-	std::cout << "Serial device set to " << serialDevice << std::endl;
+	setEsp3Crcs(data);
+	writePacket(data);
+}
 
-	_enoceanInterface = std::string(argv[2]);
-	std::cout << "EnOcean interface set to " << _enoceanInterface << std::endl;
+void writePacket(const std::vector<char>& data)
+{
+	TraceSpan sendSpan("Send");
+	std::lock_guard<std::recursive_mutex> serialGuard(_serialMutex);
+	while(!readPacket(0).empty()) {} // Take link quality samples from everything received since the last frame
 
-	std::unique_ptr<BaseLib::SharedObjects> bl(new BaseLib::SharedObjects(std::string(""), nullptr, false));
 	try
 	{
-		_serial.reset(new BaseLib::SerialReaderWriter(bl.get(), serialDevice, 57600, 0, true, -1));
-		_serial->openDevice(false, false, false);
-
-		getAddress();
-
-		runTests();
+		{
+			TraceSpan reconnectSpan("Reconnect", "", _transportTrack);
+			_transport->reconnect(); // Reconnect to avoid duty cycle limit
+		}
+		TraceSpan frameSpan("Frame", isTracing() ? BaseLib::HelperFunctions::getHexString(data) : "", _transportTrack);
+		_transport->write(data);
 	}
 	catch(BaseLib::Exception& ex)
 	{
-		std::cerr << ex.what() << std::endl;
-		exit(1);
+		std::cerr << ex.what() << std::endl; // E. g. the TCP bridge dropped the connection
+		stopTests(1);
 	}
-	catch(std::exception& ex)
+	_metrics->framesSent.fetch_add(1, std::memory_order_relaxed);
+
+	int32_t sendDelay = 0;
 	{
-		std::cerr << ex.what() << std::endl;
-		exit(1);
+		std::lock_guard<std::recursive_mutex> linkQualityGuard(_linkQualityMutex);
+		sendDelay = _linkQuality.sendDelay;
 	}
+	TraceSpan throttleSpan("Duty cycle wait", isTracing() ? std::to_string(sendDelay / 1000) + " ms" : "", _transportTrack);
+	usleep(sendDelay);
+}
 
-	_serial->closeDevice();
+/**
+ * With probability _faultRate sends one faulty frame from the given sender ID. Radio level faults (wrong data lengths,
+ * unknown RORGs and out-of-range 4BS values) are transmitted by the USB 300. ESP3 level faults (bad CRCs, truncated
+ * frames) are rejected by a real USB 300, so they are only sent with "--esp3-faults".
+ */
+void sendFaults(uint32_t address)
+{
+	if(_faultRate <= 0 || std::uniform_real_distribution<double>(0, 1)(_random) >= _faultRate) return;
 
-	return 0;
+	int32_t firstType = _esp3Faults ? (int32_t)FaultType::dataCrc : (int32_t)FaultType::wrongLength;
+	FaultType type = (FaultType)std::uniform_int_distribution<int32_t>(firstType, (int32_t)FaultType::count - 1)(_random);
+	_faultsSent[(int32_t)type]++;
+
+	std::uniform_int_distribution<int32_t> byteDistribution(0, 255);
+	switch(type)
+	{
+		case FaultType::dataCrc:
+		case FaultType::headerCrc:
+		case FaultType::truncated:
+		{
+			std::vector<char> packet = getRadioPacket(std::vector<char>{ (char)(uint8_t)0xA5, (char)byteDistribution(_random), (char)byteDistribution(_random), (char)byteDistribution(_random), 0x08 }, address);
+			setEsp3Crcs(packet);
+
+			if(type == FaultType::dataCrc) packet.back() ^= 0x5A;
+			else if(type == FaultType::headerCrc) packet[5] ^= 0x5A;
+			else packet.resize(std::uniform_int_distribution<int32_t>(2, packet.size() - 2)(_random));
+			writePacket(packet);
+			break;
+		}
+		case FaultType::wrongLength:
+		{
+			std::vector<char> data{ (char)(uint8_t)0xA5 };
+			int32_t length = std::uniform_int_distribution<int32_t>(0, 4)(_random);
+			if(length >= 4) length++; // 4 data bytes would be valid
+			for(int32_t i = 0; i < length; i++) data.push_back((char)byteDistribution(_random));
+			sendPacket(getRadioPacket(data, address));
+			break;
+		}
+		case FaultType::unknownRorg:
+			sendPacket(getRadioPacket(std::vector<char>{ 0x3F, (char)byteDistribution(_random), (char)byteDistribution(_random), (char)byteDistribution(_random), (char)byteDistribution(_random) }, address));
+			break;
+		case FaultType::outOfRange:
+			sendPacket(getRadioPacket(std::vector<char>{ (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF }, address));
+			break;
+		default:
+			break;
+	}
 }
 
-void runTests()
+/**
+ * Takes the RSSI from the optional data of received ERP1 frames (sub telegram number, destination ID, dBm, security
+ * level).
+ */
+void recordReceivedPacket(const std::vector<char>& packet)
 {
-	testF6();
-	testA5();
+	_metrics->framesReceived.fetch_add(1, std::memory_order_relaxed);
+	if(packet.size() < 7 || packet[4] != 1 || packet[3] != 7) return;
+	uint32_t dataSize = ((uint32_t)(uint8_t)packet[1] << 8) | (uint8_t)packet[2];
+	int32_t rssi = -(int32_t)(uint8_t)packet.at(6 + dataSize + 5);
+	std::lock_guard<std::recursive_mutex> linkQualityGuard(_linkQualityMutex);
+	_linkQuality.frames++;
+	_linkQuality.rssi = _linkQuality.frames == 1 ? rssi : (_linkQuality.rssi * 15 + rssi) / 16;
+	if(rssi < _linkQuality.minRssi) _linkQuality.minRssi = rssi;
+	if(rssi > _linkQuality.maxRssi) _linkQuality.maxRssi = rssi;
+	_metrics->rssi.store((int64_t)_linkQuality.rssi, std::memory_order_relaxed);
 }
 
-void testA502(std::string eep, int32_t maxIndex, double maxTemperature, double factor)
+/**
+ * Records the outcome of one attempt of a sweep step and adapts the send pacing: Each retry increases the delay after a
+ * frame by 50 %, each run of 32 successful steps decreases it by 5 ms.
+ */
+void recordStep(bool success, bool frameLost)
 {
-	std::cout << std::endl << "Testing EEP " << eep << "... Values should go from " << std::fixed << std::setprecision(1) << (maxTemperature - ((double)maxIndex / factor)) << "°C to " << maxTemperature << "°C... " << std::endl;
-	uint64_t peerId = createDevice(eep);
-	sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, (char)(uint8_t)0x0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-	sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, (char)(uint8_t)0x0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-	sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, (char)(uint8_t)0x0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-	sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-	sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-	sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-	if(getDoubleValue(peerId, 1, "TEMPERATURE") != maxTemperature)
-	{
-		deleteDevice(peerId);
-		std::cerr << "Wrong value returned" << std::endl;
-		exit(1);
-	}
-	int32_t retries = 5;
-	for(int32_t i = maxIndex; i >= 0; i--)
+	std::lock_guard<std::recursive_mutex> linkQualityGuard(_linkQualityMutex);
+	_linkQuality.steps++;
+	_linkQuality.retryRate = _linkQuality.retryRate * 0.98 + (success ? 0 : 0.02);
+	if(success)
 	{
-		if(retries != 5) i++;
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)(i >> 8), (char)(uint8_t)(i & 0xFF), 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		int32_t value = std::lround((maxTemperature - getDoubleValue(peerId, 1, "TEMPERATURE")) * factor);
-		if(value != i)
+		_linkQuality.successStreak++;
+		if(_linkQuality.successStreak >= 32)
 		{
-			retries--;
-			if(retries > 0)
-			{
-				std::cout << 'r';
-				continue;
-			}
-			std::cerr << "Wrong value returned for binary value " << i << ": " << value << std::endl;
-			deleteDevice(peerId);
-			exit(1);
+			_linkQuality.successStreak = 0;
+			_linkQuality.sendDelay = std::max(_linkQuality.minSendDelay, _linkQuality.sendDelay - 5000);
+			updateSendDelayMetrics();
 		}
-		retries = 5;
-		std::cout << (i > 0 ? "." : ".; done.\n") << std::flush;
+		_metrics->steps.fetch_add(1, std::memory_order_relaxed);
+		return;
 	}
-	deleteDevice(peerId);
+
+	_linkQuality.retries++;
+	if(frameLost) _linkQuality.lostFrames++;
+	else _linkQuality.wrongValues++;
+	_linkQuality.successStreak = 0;
+	_linkQuality.sendDelay = std::min(_linkQuality.maxSendDelay, _linkQuality.sendDelay * 3 / 2);
+	updateSendDelayMetrics();
+	_metrics->retries.fetch_add(1, std::memory_order_relaxed);
+	(frameLost ? _metrics->lostFrames : _metrics->wrongValues).fetch_add(1, std::memory_order_relaxed);
 }
 
-void testA50401()
+/**
+ * The headroom is how far the send delay may still grow before the pacing hits its maximum: 100 % at the minimum delay,
+ * 0 % when frames are already sent as slowly as allowed.
+ */
+void updateSendDelayMetrics()
 {
-	std::cout << std::endl << "Testing EEP A50401... Values should go from 0% to 100% and from 0°C to 40°C... " << std::endl;
-	uint64_t peerId = createDevice("A50401");
+	std::lock_guard<std::recursive_mutex> linkQualityGuard(_linkQualityMutex);
+	_metrics->sendDelay.store(_linkQuality.sendDelay, std::memory_order_relaxed);
+	_metrics->dutyCycleHeadroom.store((int64_t)100 * (_linkQuality.maxSendDelay - _linkQuality.sendDelay) / (_linkQuality.maxSendDelay - _linkQuality.minSendDelay), std::memory_order_relaxed);
+}
 
-	// {{{ LRN bit
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0, (char)(uint8_t)0x0, 0x0A, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0, (char)(uint8_t)0x0, 0x0A, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0, (char)(uint8_t)0x0, 0x0A, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		if(getDoubleValue(peerId, 1, "TEMPERATURE") != 0 || getDoubleValue(peerId, 1, "HUMIDITY") != 0)
-		{
-			deleteDevice(peerId);
-			std::cerr << "Wrong value returned (1)" << std::endl;
-			exit(1);
-		}
-	// }}}
+TestMetrics::TestMetrics(int32_t workerCount) :
+	framesSent(addCounter("enocean_tests_frames_sent_total", "ESP3 frames written to the gateway.")),
+	framesReceived(addCounter("enocean_tests_frames_received_total", "ESP3 packets read from the gateway.")),
+	steps(addCounter("enocean_tests_steps_total", "Verified sweep steps and checks.")),
+	retries(addCounter("enocean_tests_retries_total", "Retried sweep steps and checks.")),
+	lostFrames(addCounter("enocean_tests_lost_frames_total", "Retries where the peer still reported the previous values.")),
+	wrongValues(addCounter("enocean_tests_wrong_values_total", "Retries where the peer reported unexpected values.")),
+	tests(addCounter("enocean_tests_tests_total", "Finished tests.")),
+	sendDelay(addGauge("enocean_tests_send_delay_microseconds", "Pause after each frame.")),
+	dutyCycleHeadroom(addGauge("enocean_tests_duty_cycle_headroom_percent", "Room of the send delay before the slowest pacing.")),
+	rssi(addGauge("enocean_tests_rssi_dbm", "Moving average of the RSSI of received telegrams.")),
+	rpcLatency(addHistogram("enocean_tests_rpc_latency_microseconds", "Duration of RPC calls to Homegear.")),
+	stepLatency(addHistogram("enocean_tests_step_latency_microseconds", "Time from sending a step's frame until its values were verified."))
+{
+	for(int32_t i = 0; i < workerCount; i++) workerSteps.push_back(&addText("enocean_tests_worker_step{worker=\"" + std::to_string(i + 1) + "\"}", "Test and step the worker is running."));
+}
 
-	// {{{ Temperature data available?
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0, (char)(uint8_t)0x0, 0x0A, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0, (char)(uint8_t)0x0, 0x0A, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0, (char)(uint8_t)0x0, 0x0A, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0xFA, (char)(uint8_t)0xFA, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0xFA, (char)(uint8_t)0xFA, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0xFA, (char)(uint8_t)0xFA, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		if(getDoubleValue(peerId, 1, "TEMPERATURE") != 0 || getDoubleValue(peerId, 1, "HUMIDITY") != 100)
-		{
-			deleteDevice(peerId);
-			std::cerr << "Wrong value returned (2)" << std::endl;
-			exit(1);
-		}
-	// }}}
+bool isLinkWeak()
+{
+	std::lock_guard<std::recursive_mutex> linkQualityGuard(_linkQualityMutex);
+	return (_linkQuality.frames > 0 && _linkQuality.rssi < _linkQuality.weakRssi) || _linkQuality.retryRate > 0.1;
+}
+
+/**
+ * On a good link a mismatch is most likely a conversion error, so we give up early. On a weak link frames get lost and
+ * retrying is worth it.
+ */
+int32_t getRetryBudget()
+{
+	std::lock_guard<std::recursive_mutex> linkQualityGuard(_linkQualityMutex);
+	if(isLinkWeak()) return 10;
+	if(_linkQuality.steps >= 100 && _linkQuality.retryRate < 0.01) return 3;
+	return 5;
+}
 
-	int32_t retries = 5;
-	for(int32_t i = 250; i >= 0; i--)
+void printLinkQuality()
+{
+	std::lock_guard<std::recursive_mutex> linkQualityGuard(_linkQualityMutex);
+	std::cout << "Link quality: ";
+	if(_linkQuality.frames > 0) std::cout << "RSSI " << std::fixed << std::setprecision(1) << _linkQuality.rssi << " dBm (" << _linkQuality.minRssi << " to " << _linkQuality.maxRssi << " dBm, " << _linkQuality.frames << " frames)";
+	else std::cout << "no frames received";
+	std::cout << ", " << _linkQuality.retries << " retries in " << _linkQuality.steps << " attempts (" << _linkQuality.lostFrames << " lost frames, " << _linkQuality.wrongValues << " wrong values), send delay " << (_linkQuality.sendDelay / 1000) << " ms" << std::endl;
+	if(_linkQuality.retries == 0) return;
+	if(_linkQuality.wrongValues == 0 || (isLinkWeak() && _linkQuality.lostFrames >= _linkQuality.wrongValues)) std::cout << "Retries line up with a weak radio link. Consider moving the USB 300 before rerunning." << std::endl;
+	else std::cout << "Retries are mostly not caused by lost frames. Check the conversions." << std::endl;
+}
+
+/**
+ * Stores the values all instances returned for one verified step of eep, compared to the reference instance.
+ */
+void recordComparison(const std::string& eep, const std::string& step, const std::vector<std::string>& variables, const std::vector<std::vector<double>>& values, const std::vector<int64_t>& latencies)
+{
+	if(_instances.size() < 2) return;
+	std::lock_guard<std::mutex> comparisonGuard(_comparisonMutex);
+	std::vector<InstanceResult>& results = _comparison[eep];
+	results.resize(_instances.size());
+	for(size_t i = 0; i < values.size(); i++)
 	{
-		if(retries != 5) i++;
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)i, (char)(uint8_t)i, 0x0A, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		int32_t temperatureValue = std::lround(getDoubleValue(peerId, 1, "TEMPERATURE") * 6.25);
-		int32_t humidityValue = std::lround(getDoubleValue(peerId, 1, "HUMIDITY") * 2.5);
-		if(temperatureValue != i || humidityValue != i)
+		results[i].latencies.push_back(latencies.at(i));
+		if(i == 0 || values[i] == values[0]) continue;
+		results[i].differences++;
+		if(results[i].examples.size() >= 3) continue;
+		std::ostringstream example;
+		example << step << ":";
+		for(size_t j = 0; j < variables.size(); j++)
 		{
-			retries--;
-			if(retries > 0)
-			{
-				std::cout << 'r';
-				continue;
-			}
-			std::cerr << "Wrong values returned for binary value " << i << ": " << temperatureValue << ", " << humidityValue << std::endl;
-			deleteDevice(peerId);
-			exit(1);
+			if(values[i].at(j) != values[0].at(j)) example << ' ' << variables[j] << '=' << values[i][j] << " (reference " << values[0][j] << ')';
 		}
-		retries = 5;
-		std::cout << (i > 0 ? "." : ".; done.\n") << std::flush;
+		results[i].examples.push_back(example.str());
 	}
-	deleteDevice(peerId);
 }
 
-void testA50402()
+/**
+ * Prints per EEP and instance the number of steps with values other than the reference's and the latency distribution.
+ */
+void printComparison()
 {
-	std::cout << std::endl << "Testing EEP A50402... Values should go from 0% to 100% and from -20°C to 60°C... " << std::endl;
-	uint64_t peerId = createDevice("A50402");
+	if(_instances.size() < 2) return;
+	std::lock_guard<std::mutex> comparisonGuard(_comparisonMutex);
+	auto getPercentile = [](const std::vector<int64_t>& latencies, int32_t percentile) { return latencies.empty() ? 0 : latencies.at((latencies.size() - 1) * percentile / 100) / 1000.0; };
 
-	// {{{ LRN bit
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0, (char)(uint8_t)0x0, 0x0A, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0, (char)(uint8_t)0x0, 0x0A, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0, (char)(uint8_t)0x0, 0x0A, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0xFA, (char)(uint8_t)0xFA, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0xFA, (char)(uint8_t)0xFA, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0xFA, (char)(uint8_t)0xFA, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		if(getDoubleValue(peerId, 1, "TEMPERATURE") != -20 || getDoubleValue(peerId, 1, "HUMIDITY") != 0)
+	std::cout << std::endl << "EEP    | Instance                       | Steps | Differences | P50 latency (ms) | P90 latency (ms) | Max. latency (ms)" << std::endl;
+	int64_t differences = 0;
+	for(auto& eepResults : _comparison)
+	{
+		for(size_t i = 0; i < eepResults.second.size(); i++)
 		{
-			deleteDevice(peerId);
-			std::cerr << "Wrong value returned (1)" << std::endl;
-			exit(1);
+			InstanceResult& result = eepResults.second[i];
+			std::sort(result.latencies.begin(), result.latencies.end());
+			std::string name = i == 0 ? "reference" : _instances.at(i).configDirectory;
+			std::cout << std::setw(6) << std::left << eepResults.first << " | " << std::setw(30) << name << std::right << " | " << std::setw(5) << result.latencies.size() << " | " << std::setw(11) << result.differences << " | " << std::fixed << std::setprecision(1) << std::setw(16) << getPercentile(result.latencies, 50) << " | " << std::setw(16) << getPercentile(result.latencies, 90) << " | " << std::setw(17) << getPercentile(result.latencies, 100) << std::endl;
+			for(auto& example : result.examples) std::cout << "         " << example << std::endl;
+			differences += result.differences;
 		}
-	// }}}
+	}
+	std::cout << (differences == 0 ? "All instances returned the same values." : std::to_string(differences) + " steps with different values.") << std::endl;
+}
 
-	// {{{ Temperature data available?
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0, (char)(uint8_t)0x0, 0x0A, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0, (char)(uint8_t)0x0, 0x0A, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0, (char)(uint8_t)0x0, 0x0A, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0xFA, (char)(uint8_t)0xFA, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0xFA, (char)(uint8_t)0xFA, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0xFA, (char)(uint8_t)0xFA, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		if(getDoubleValue(peerId, 1, "TEMPERATURE") != -20 || getDoubleValue(peerId, 1, "HUMIDITY") != 100)
-		{
-			deleteDevice(peerId);
-			std::cerr << "Wrong value returned (2)" << std::endl;
-			exit(1);
-		}
-	// }}}
+int32_t getRawRegion(const EepField& field, int32_t raw)
+{
+	int32_t regionSize = std::max(1, (field.rawMax - field.rawMin + 8) / 8);
+	return std::max(0, std::min(7, (raw - field.rawMin) / regionSize));
+}
 
-	int32_t retries = 5;
-	for(int32_t i = 250; i >= 0; i--)
+/**
+ * Stores deviation with the current link RSSI. With "--deviations" it is also appended to the file, so nightly runs
+ * can be compared.
+ */
+void recordDeviation(Deviation deviation)
+{
 	{
-		if(retries != 5) i++;
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)i, (char)(uint8_t)i, 0x0A, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		int32_t temperatureValue = std::lround((getDoubleValue(peerId, 1, "TEMPERATURE") + 20) * 3.125);
-		int32_t humidityValue = std::lround(getDoubleValue(peerId, 1, "HUMIDITY") * 2.5);
-		if(temperatureValue != i || humidityValue != i)
-		{
-			retries--;
-			if(retries > 0)
-			{
-				std::cout << 'r';
-				continue;
-			}
-			std::cerr << "Wrong values returned for binary value " << i << ": " << temperatureValue << ", " << humidityValue << std::endl;
-			deleteDevice(peerId);
-			exit(1);
-		}
-		retries = 5;
-		std::cout << (i > 0 ? "." : ".; done.\n") << std::flush;
+		std::lock_guard<std::recursive_mutex> linkQualityGuard(_linkQualityMutex);
+		deviation.rssi = _linkQuality.frames > 0 ? std::lround(_linkQuality.rssi) : 0;
+	}
+	deviation.time = BaseLib::HelperFunctions::getTime();
+
+	std::lock_guard<std::mutex> deviationsGuard(_deviationsMutex);
+	if(!_deviationsFilename.empty())
+	{
+		static const char* kindNames[] = { "lost", "wrong", "tolerated", "instance" };
+		if(!_deviationsFile.is_open()) _deviationsFile.open(_deviationsFilename, std::ios::app);
+		_deviationsFile << deviation.time << ' ' << deviation.eep << ' ' << (deviation.variable.empty() ? "-" : deviation.variable) << ' ' << kindNames[(int32_t)deviation.kind] << ' ' << deviation.raw << ' ' << deviation.deviation << ' ' << deviation.attempt << ' ' << deviation.latency << ' ' << deviation.rssi << '\n';
+	}
+	_deviations.push_back(std::move(deviation));
+}
+
+/**
+ * Counts the step per field and raw region, so the report can tell deviations at every raw value of a region from
+ * occasional ones.
+ */
+void recordVerifiedStep(const EepDescriptor& descriptor, const EepPass& pass, int32_t index)
+{
+	std::lock_guard<std::mutex> deviationsGuard(_deviationsMutex);
+	for(size_t i = 0; i < descriptor.fields.size(); i++)
+	{
+		const EepField& field = descriptor.fields[i];
+		if(field.threshold >= 0) continue;
+		std::vector<int64_t>& regions = _verifiedRegions[descriptor.eep + ' ' + field.variable];
+		regions.resize(8);
+		regions.at(getRawRegion(field, getStepRaw(pass, i, field, index)))++;
 	}
-	deleteDevice(peerId);
 }
 
-void testA50403()
+/**
+ * Prints retries and tolerated deviations per EEP, variable and raw region, followed by a verdict per EEP: Value
+ * deviations concentrated in a region with one dominant offset point to the conversion (e. g. rounding), lost frames
+ * without such a pattern to the radio link.
+ */
+void printDeviations()
 {
-	std::cout << std::endl << "Testing EEP A50403... Values should go from 0% to 100% and from -20°C to 60°C... " << std::endl;
-	uint64_t peerId = createDevice("A50403");
+	std::lock_guard<std::mutex> deviationsGuard(_deviationsMutex);
+	if(_deviations.empty()) return;
 
-	// {{{ LRN bit
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0, (char)(uint8_t)0x0, 0x0A, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0, (char)(uint8_t)0x0, 0x0A, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, (char)(uint8_t)0, (char)(uint8_t)0x0, 0x0A, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, 0x03, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, 0x03, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, 0x03, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		if(getDoubleValue(peerId, 1, "TEMPERATURE") != -20 || getDoubleValue(peerId, 1, "HUMIDITY") != 0)
+	struct DeviationGroup
+	{
+		int64_t lostFrames = 0;
+		int64_t wrongValues = 0;
+		int64_t tolerated = 0;
+		int64_t otherInstance = 0;
+		int64_t rssiSum = 0;
+		int64_t latencySum = 0;
+		int32_t maxAttempt = 0;
+		int32_t rawMin = 0;
+		int32_t rawMax = 0;
+		std::map<int32_t, int64_t> offsets; // Count by deviation of wrong and tolerated values
+		std::set<int32_t> raws;
+		std::set<int32_t> offsetRaws;
+	};
+
+	// By EEP, variable and region. Retries of a sweep step are recorded for every field with the step's raw value, retried
+	// checks are grouped under an empty variable.
+	std::map<std::string, std::map<std::string, std::map<int32_t, DeviationGroup>>> groups;
+	std::map<std::string, std::pair<int64_t, int64_t>> lostFrames; // By EEP, count and RSSI sum of lost frames
+	for(auto& deviation : _deviations)
+	{
+		if(deviation.kind == DeviationKind::lostFrame && deviation.field <= 0)
 		{
-			deleteDevice(peerId);
-			std::cerr << "Wrong value returned (1)" << std::endl;
-			exit(1);
+			lostFrames[deviation.eep].first++;
+			lostFrames[deviation.eep].second += deviation.rssi;
 		}
-	// }}}
 
-	int32_t retries = 5;
-	for(int32_t i = 1023; i >= 0; i--)
+		DeviationGroup& group = groups[deviation.eep][deviation.variable][deviation.region];
+		if(deviation.kind == DeviationKind::lostFrame) group.lostFrames++;
+		else if(deviation.kind == DeviationKind::wrongValue) group.wrongValues++;
+		else if(deviation.kind == DeviationKind::tolerated) group.tolerated++;
+		else group.otherInstance++;
+		group.rssiSum += deviation.rssi;
+		group.latencySum += deviation.latency;
+		group.maxAttempt = std::max(group.maxAttempt, deviation.attempt);
+		if(deviation.variable.empty()) continue;
+		group.raws.insert(deviation.raw);
+		group.rawMin = *group.raws.begin();
+		group.rawMax = *group.raws.rbegin();
+		if(deviation.kind != DeviationKind::wrongValue && deviation.kind != DeviationKind::tolerated) continue;
+		group.offsets[deviation.deviation]++;
+		group.offsetRaws.insert(deviation.raw);
+	}
+
+	std::cout << std::endl << "EEP    | Variable         | Raw values  | Lost | Wrong | Tolerated | Instances | Offsets (count)        | Max. attempt | Avg. RSSI | Avg. latency (ms)" << std::endl;
+	for(auto& eepGroups : groups)
 	{
-		if(retries != 5) i++;
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)(i / 4), (char)(uint8_t)(i >> 8), (char)(uint8_t)(i & 0xFF), 0x0A, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		int32_t temperatureValue = std::lround((getDoubleValue(peerId, 1, "TEMPERATURE") + 20) * 12.7875);
-		int32_t humidityValue = std::lround(getDoubleValue(peerId, 1, "HUMIDITY") * 2.55);
-		if((temperatureValue != i && temperatureValue != i - 1  && temperatureValue != i + 1) || humidityValue != (i / 4))
+		std::vector<std::string> systematic;
+		for(auto& variableGroups : eepGroups.second)
 		{
-			retries--;
-			if(retries > 0)
+			for(auto& regionGroup : variableGroups.second)
 			{
-				std::cout << 'r';
-				continue;
+				const DeviationGroup& group = regionGroup.second;
+				int64_t count = group.lostFrames + group.wrongValues + group.tolerated + group.otherInstance;
+
+				std::ostringstream offsets;
+				for(auto& offset : group.offsets) offsets << (offset.first > 0 ? "+" : "") << offset.first << " (" << offset.second << ") ";
+				std::string rawValues = variableGroups.first.empty() ? "" : (group.rawMin == group.rawMax ? std::to_string(group.rawMin) : std::to_string(group.rawMin) + "-" + std::to_string(group.rawMax));
+				std::cout << std::setw(6) << std::left << eepGroups.first << " | " << std::setw(16) << (variableGroups.first.empty() ? "(whole step)" : variableGroups.first) << " | " << std::setw(11) << rawValues << std::right << " | " << std::setw(4) << group.lostFrames << " | " << std::setw(5) << group.wrongValues << " | " << std::setw(9) << group.tolerated << " | " << std::setw(9) << group.otherInstance << " | " << std::setw(22) << std::left << offsets.str() << std::right << " | " << std::setw(12) << group.maxAttempt << " | " << std::setw(9) << group.rssiSum / count << " | " << std::setw(17) << group.latencySum / count << std::endl;
+
+				// {{{ Systematic: One offset dominates and it shows up at a large share of the region's verified steps
+					if(group.offsets.empty()) continue;
+					auto dominant = std::max_element(group.offsets.begin(), group.offsets.end(), [](const std::pair<const int32_t, int64_t>& a, const std::pair<const int32_t, int64_t>& b) { return a.second < b.second; });
+					int64_t valueDeviations = group.wrongValues + group.tolerated;
+					int64_t verifiedSteps = 0;
+					auto verifiedIterator = _verifiedRegions.find(eepGroups.first + ' ' + variableGroups.first);
+					if(verifiedIterator != _verifiedRegions.end() && regionGroup.first >= 0) verifiedSteps = verifiedIterator->second.at(regionGroup.first);
+					if(dominant->second < 3 || dominant->second * 10 < valueDeviations * 9 || dominant->second * 2 < std::max(verifiedSteps, (int64_t)group.offsetRaws.size())) continue;
+					std::ostringstream description;
+					description << variableGroups.first << " is off by " << (dominant->first > 0 ? "+" : "") << dominant->first << " at raw " << *group.offsetRaws.begin() << " to " << *group.offsetRaws.rbegin() << " (" << dominant->second << " times";
+					if(verifiedSteps > 0) description << " in " << verifiedSteps << " verified steps";
+					description << ')';
+					systematic.push_back(description.str());
+				// }}}
 			}
-			std::cerr << "Wrong values returned for binary value " << i << ": " << temperatureValue << ", " << humidityValue << std::endl;
-			deleteDevice(peerId);
-			exit(1);
 		}
-		retries = 5;
-		std::cout << (i > 0 ? "." : ".; done.\n") << std::flush;
+
+		for(auto& description : systematic) std::cout << "  " << eepGroups.first << ": " << description << ". Systematic, check the conversion (e. g. rounding) instead of retrying." << std::endl;
+		const std::pair<int64_t, int64_t>& lost = lostFrames[eepGroups.first];
+		if(systematic.empty() && lost.first > 0) std::cout << "  " << eepGroups.first << ": " << lost.first << " lost frames at " << (lost.second / lost.first) << " dBm on average and no systematic value deviations. Retries are caused by the radio link." << std::endl;
 	}
-	deleteDevice(peerId);
 }
 
-void testA50501()
+std::vector<char> getRadioPacket(const std::vector<char>& data)
 {
-	std::cout << std::endl << "Testing EEP A50501... Values should go from 500 hPa to 1150 hPa... " << std::endl;
-	uint64_t peerId = createDevice("A50501");
+	return getRadioPacket(data, _intAddress);
+}
 
-	// {{{ LRN bit
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0x03, (char)(uint8_t)0xFF, 0, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0x03, (char)(uint8_t)0xFF, 0, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0x03, (char)(uint8_t)0xFF, 0, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		if(getDoubleValue(peerId, 1, "PRESSURE") != 500)
-		{
-			deleteDevice(peerId);
-			std::cerr << "Wrong value returned (1)" << std::endl;
-			exit(1);
-		}
-	// }}}
+std::vector<char> getRadioPacket(const std::vector<char>& data, uint32_t address)
+{
+	std::vector<char> packet{ 0x55, (char)(uint8_t)((data.size() + 5) >> 8), (char)(uint8_t)(data.size() + 5), 0x07, 0x01, 0x00 };
+	packet.reserve(data.size() + 20);
+	packet.insert(packet.end(), data.begin(), data.end());
+	packet.insert(packet.end(), { (char)(uint8_t)(address >> 24), (char)(uint8_t)(address >> 16), (char)(uint8_t)(address >> 8), (char)(uint8_t)address });
+	packet.insert(packet.end(), { 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
+	return packet;
+}
 
-	int32_t retries = 5;
-	for(int32_t i = 1023; i >= 0; i--)
+std::vector<char> getTeachInPacket(std::string eep, uint32_t address)
+{
+	uint32_t eepNumber = BaseLib::Math::getNumber(eep, true);
+	uint8_t rorg = eepNumber >> 16;
+	uint8_t func = (eepNumber >> 8) & 0xFF;
+	uint8_t type = eepNumber & 0xFF;
+	uint16_t manufacturer = 0x7FF; // Multi user manufacturer ID
+
+	if(rorg == 0xA5)
+	{
+		// 4BS teach-in variant 2 (LRN type bit set, LRN bit cleared)
+		return getRadioPacket(std::vector<char>{ (char)(uint8_t)0xA5, (char)(uint8_t)((func << 2) | (type >> 5)), (char)(uint8_t)(((type & 0x1F) << 3) | (manufacturer >> 8)), (char)(uint8_t)(manufacturer & 0xFF), (char)(uint8_t)0x80 }, address);
+	}
+	else if(rorg == 0xD2)
+	{
+		// UTE teach-in query: unidirectional, no response expected, all channels
+		return getRadioPacket(std::vector<char>{ (char)(uint8_t)0xD4, 0x40, (char)(uint8_t)0xFF, (char)(uint8_t)(manufacturer & 0xFF), (char)(uint8_t)(manufacturer >> 8), (char)type, (char)func, (char)(uint8_t)0xD2 }, address);
+	}
+	else if(rorg == 0xD5)
+	{
+		// 1BS teach-in (LRN bit cleared)
+		return getRadioPacket(std::vector<char>{ (char)(uint8_t)0xD5, 0 }, address);
+	}
+	return std::vector<char>();
+}
+
+/**
+ * Sends one data telegram followed by one teach-in telegram and checks with a single value read per Homegear instance
+ * that the peer decoded the data telegram and ignored the teach-in telegram. Retries until all instances pass. Returns
+ * false if the reference doesn't pass, other instances that don't are recorded as differences.
+ */
+bool teachIn(const TestPeer& peer, std::string eep, std::vector<char> data, std::vector<std::string> variables, std::vector<double> expectedValues)
+{
+	std::vector<char> dataPacket = getRadioPacket(data, peer.address());
+	std::vector<char> teachInPacket = getTeachInPacket(eep, peer.address());
+	int32_t retryBudget = getRetryBudget();
+	std::vector<std::vector<double>> values;
+	std::vector<int64_t> latencies;
+	for(int32_t retries = retryBudget; retries > 0; retries--)
 	{
-		if(retries != 5) i++;
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)(i >> 8), (char)(uint8_t)(i & 0xFF), 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		int32_t value = std::lround((getDoubleValue(peerId, 1, "PRESSURE") -500) * 1.573846);
-		if(value != i && value != i - 1  && value != i + 1)
+		TraceSpan attemptSpan(retries == retryBudget ? "Teach-in" : "Retry", eep);
+		int64_t sendTime = BaseLib::HelperFunctions::getTimeMicroseconds();
+		sendPacket(dataPacket);
+		if(!teachInPacket.empty()) sendPacket(teachInPacket);
+		values = getInstanceValues(peer, 1, variables, sendTime, latencies);
+		if(std::all_of(values.begin(), values.end(), [&](const std::vector<double>& instanceValues) { return instanceValues == expectedValues; }))
 		{
-			retries--;
-			if(retries > 0)
-			{
-				std::cout << 'r';
-				continue;
-			}
-			std::cerr << "Wrong value returned for binary value " << i << ": " << value << std::endl;
-			deleteDevice(peerId);
-			exit(1);
+			recordStep(true, false);
+			recordComparison(eep, "teach-in", variables, values, latencies);
+			return true;
 		}
-		retries = 5;
-		std::cout << (i > 0 ? "." : ".; done.\n") << std::flush;
+		recordStep(false, true);
+		std::cout << 'r' << std::flush;
 	}
-	deleteDevice(peerId);
+
+	// Only the reference decides whether the test can go on, a failed teach-in on another instance is a difference
+	if(values.empty() || values.front() != expectedValues) return false;
+	recordComparison(eep, "teach-in", variables, values, latencies);
+	return true;
 }
 
-void testA50601()
+std::vector<char> getEepData(const EepDescriptor& descriptor, const std::vector<uint8_t>& data)
 {
-	std::cout << std::endl << "Testing EEP A50601... Values should go from 300 lx to 30000 lx for ILLUMINATION2 and from 600 lx to 60000 lx for ILLUMINATION1... " << std::endl;
-	uint64_t peerId = createDevice("A50601");
+	std::vector<char> eepData{ (char)descriptor.rorg };
+	eepData.insert(eepData.end(), data.begin(), data.end());
+	return eepData;
+}
 
-	// {{{ LRN bit
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		if(getDoubleValue(peerId, 1, "SUPPLY_VOLTAGE") != 0.0 || getIntValue(peerId, 1, "ILLUMINATION_1") != 600.0 || getIntValue(peerId, 1, "ILLUMINATION_2") != 300.0)
+void testEep(const std::string& eep)
+{
+	const EepDescriptor* descriptor = findEepDescriptor(eep);
+	if(!descriptor)
+	{
+		std::cerr << "No descriptor for EEP " << eep << "." << std::endl;
+		stopTests(1);
+	}
+	testEep(*descriptor);
+}
+
+void testEep(const EepDescriptor& descriptor)
+{
+	testEep(descriptor, _sampleSteps);
+}
+
+/**
+ * Distance between two sent steps of a pass when only about sampleSteps of them should be sent. Rows of covering
+ * arrays are never skipped, each of them covers combinations the others don't.
+ */
+int32_t getSampleStride(const EepPass& pass, int32_t sampleSteps)
+{
+	return sampleSteps > 0 && pass.rows.empty() ? std::max(1, (pass.steps + sampleSteps - 1) / sampleSteps) : 1;
+}
+
+int64_t getFrameCount(const EepDescriptor& descriptor, int32_t sampleSteps)
+{
+	int64_t frames = 0;
+	for(auto& check : descriptor.checks) frames += check.frames.size();
+	for(auto& pass : descriptor.passes)
+	{
+		int32_t stride = getSampleStride(pass, sampleSteps);
+		frames += (pass.steps + stride - 1) / stride + 1;
+	}
+	return frames;
+}
+
+/**
+ * Runs the checks and passes of an EEP descriptor. The steps are distributed over several peers of the same EEP, each
+ * with its own sender ID from the USB 300's base ID range. While the values of one peer are read, the frames of the
+ * other peers are sent, so several steps are in flight at once. The number of peers follows the ratio of the measured
+ * RPC latency to the time needed to send one frame and is limited by _maxPipelineDepth.
+ */
+void testEep(const EepDescriptor& descriptor, int32_t sampleSteps)
+{
+	struct SweepPeer
+	{
+		TestPeer device;
+		uint32_t address = 0;
+		size_t pass = 0;
+		int32_t index = -1;
+		int32_t retries = 0;
+		int32_t attempt = 1;
+		int64_t sendTime = 0;
+		int64_t stepStart = 0; // Trace times of the step and of its current attempt
+		int64_t attemptStart = 0;
+		bool retrying = false;
+		bool busy = false;
+		std::vector<double> lastValues;
+		std::vector<std::vector<double>> lastInstanceValues; // Of all instances, to tell missed frames from differences
+		std::thread thread;
+
+		~SweepPeer()
 		{
-			deleteDevice(peerId);
-			std::cerr << "Wrong value returned (1)" << std::endl;
-			exit(1);
+			if(thread.joinable()) thread.join();
 		}
-	// }}}
+	};
 
-	int32_t retries = 5;
-	for(int32_t i = 255; i >= 0; i--)
+	struct SweepResult
+	{
+		size_t peer = 0;
+		std::vector<double> values; // Of the reference instance
+		int64_t latency = 0;
+		std::vector<std::vector<double>> instanceValues; // Of all instances, see "--compare"
+		std::vector<int64_t> instanceLatencies;
+		bool stopped = false; // The RPC thread caught TestStop
+	};
+
+	std::cout << std::endl << "Testing EEP " << descriptor.eep << "... " << descriptor.description << std::endl;
+
+	std::vector<std::string> variables;
+	std::vector<double> teachInValues;
+	for(auto& field : descriptor.fields)
 	{
-		if(retries != 5) i++;
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)i, (char)(uint8_t)i, (char)(uint8_t)i, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		int32_t value1 = std::lround(getDoubleValue(peerId, 1, "SUPPLY_VOLTAGE") * 50.0);
-		int32_t value2 = std::lround((getIntValue(peerId, 1, "ILLUMINATION_2") -300) * 0.0085858585);
-		int32_t value3 = std::lround((getIntValue(peerId, 1, "ILLUMINATION_1") -600) * 0.0042929293);
-		if(value1 != i || (value3 != i && value3 != i - 1  && value3 != i + 1) || value2 != 0)
+		variables.push_back(field.variable);
+		teachInValues.push_back(getFieldValue(field, 0));
+	}
+	std::vector<char> teachInData = getEepData(descriptor, descriptor.passes.empty() ? std::vector<uint8_t>(4, 0) : descriptor.passes.front().data);
+
+	// Declared before the peers, so their RPC threads are joined before these are destroyed when a TestStop unwinds
+	std::mutex resultMutex;
+	std::condition_variable resultConditionVariable;
+	std::deque<SweepResult> results;
+	std::vector<std::unique_ptr<SweepPeer>> peers;
+
+	auto addPeer = [&]()
+	{
+		std::unique_ptr<SweepPeer> peer(new SweepPeer());
+		peer->device = TestPeer(descriptor.eep);
+		peer->address = peer->device.address();
+		peer->retries = getRetryBudget();
+		peer->lastValues = teachInValues;
+		peer->lastInstanceValues.assign(_instances.size(), teachInValues);
+		peers.push_back(std::move(peer));
+		return teachIn(peers.back()->device, descriptor.eep, teachInData, variables, teachInValues);
+	};
+
+	auto deletePeers = [&]()
+	{
+		for(auto& peer : peers)
 		{
-			retries--;
-			if(retries > 0)
-			{
-				std::cout << 'r';
-				continue;
-			}
-			std::cerr << "Wrong values returned for binary value " << i << ": " << value1 << ' ' << value2 << ' ' << value3 << std::endl;
-			deleteDevice(peerId);
-			exit(1);
+			if(peer->thread.joinable()) peer->thread.join();
+			peer->device.reset();
 		}
-		retries = 5;
-		std::cout << (i > 0 ? "." : ".; done.\n") << std::flush;
-	}
+	};
 
-	retries = 5;
-	for(int32_t i = 255; i >= 0; i--)
+	auto getStepData = [&](size_t pass, int32_t index)
 	{
-		if(retries != 5) i++;
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)i, (char)(uint8_t)i, (char)(uint8_t)i, 0x09, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		int32_t value1 = std::lround(getDoubleValue(peerId, 1, "SUPPLY_VOLTAGE") * 50.0);
-		int32_t value2 = std::lround((getIntValue(peerId, 1, "ILLUMINATION_2") -300) * 0.0085858585);
-		int32_t value3 = std::lround((getIntValue(peerId, 1, "ILLUMINATION_1") -600) * 0.0042929293);
-		if(value1 != i || (value2 != i && value2 != i - 1  && value2 != i + 1) || value3 != 0)
+		std::vector<uint8_t> data = descriptor.passes.at(pass).data;
+		for(size_t i = 0; i < descriptor.fields.size(); i++)
 		{
-			retries--;
-			if(retries > 0)
-			{
-				std::cout << 'r';
-				continue;
-			}
-			std::cerr << "Wrong values returned for binary value " << i << ": " << value1 << ' ' << value2 << ' ' << value3 << std::endl;
-			deleteDevice(peerId);
-			exit(1);
+			const EepField& field = descriptor.fields[i];
+			setBits(data, field.bitOffset, field.bitSize, getStepRaw(descriptor.passes.at(pass), i, field, index));
 		}
-		retries = 5;
-		std::cout << (i > 0 ? "." : ".; done.\n") << std::flush;
-	}
-	deleteDevice(peerId);
-}
+		return getEepData(descriptor, data);
+	};
 
-void testA50602()
-{
-	std::cout << std::endl << "Testing EEP A50602... Values should go from 0 lx to 510 lx for ILLUMINATION2 and from 0 lx to 1020 lx for ILLUMINATION1... " << std::endl;
-	uint64_t peerId = createDevice("A50602");
+	// One deviation per field with the step's raw value for retries, which are no conversion deviations
+	auto getStepDeviations = [&](size_t pass, int32_t index, DeviationKind kind)
+	{
+		std::vector<Deviation> deviations;
+		for(size_t i = 0; i < descriptor.fields.size(); i++)
+		{
+			const EepField& field = descriptor.fields[i];
+			Deviation deviation;
+			deviation.eep = descriptor.eep;
+			deviation.variable = field.variable;
+			deviation.kind = kind;
+			deviation.raw = getStepRaw(descriptor.passes.at(pass), i, field, index);
+			deviation.region = getRawRegion(field, deviation.raw);
+			deviation.field = i;
+			deviations.push_back(deviation);
+		}
+		return deviations;
+	};
 
-	// {{{ LRN bit
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		if(getDoubleValue(peerId, 1, "SUPPLY_VOLTAGE") != 0.0 || getIntValue(peerId, 1, "ILLUMINATION_1") != 0.0 || getIntValue(peerId, 1, "ILLUMINATION_2") != 0.0)
+	// Also fills deviations with every field not read back exactly, within its tolerance or not
+	auto checkStep = [&](size_t pass, int32_t index, const std::vector<double>& values, std::vector<Deviation>& deviations)
+	{
+		const EepPass& eepPass = descriptor.passes.at(pass);
+		bool success = true;
+		for(size_t i = 0; i < descriptor.fields.size(); i++)
 		{
-			deleteDevice(peerId);
-			std::cerr << "Wrong value returned (1)" << std::endl;
-			exit(1);
+			const EepField& field = descriptor.fields[i];
+			bool inactive = std::find(eepPass.inactive.begin(), eepPass.inactive.end(), field.variable) != eepPass.inactive.end();
+			int32_t expectedRaw = inactive ? 0 : getStepRaw(eepPass, i, field, index);
+			int32_t offset = 0;
+			if(field.threshold >= 0) offset = (values.at(i) != 0 ? 1 : 0) - (expectedRaw >= field.threshold ? 1 : 0);
+			else offset = getFieldRaw(field, values.at(i)) - expectedRaw;
+			if(offset == 0) continue;
+			if(field.threshold >= 0 || std::abs(offset) > (inactive ? 0 : field.tolerance)) success = false;
+
+			Deviation deviation;
+			deviation.eep = descriptor.eep;
+			deviation.variable = field.variable;
+			deviation.raw = expectedRaw;
+			deviation.region = getRawRegion(field, expectedRaw);
+			deviation.field = i;
+			deviation.deviation = offset;
+			deviations.push_back(deviation);
 		}
-	// }}}
+		return success;
+	};
 
-	int32_t retries = 5;
-	for(int32_t i = 255; i >= 0; i--)
+	if(!addPeer())
 	{
-		if(retries != 5) i++;
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)i, (char)(uint8_t)i, (char)(uint8_t)i, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		int32_t value1 = std::lround(getDoubleValue(peerId, 1, "SUPPLY_VOLTAGE") * 50.0);
-		int32_t value2 = std::lround(getIntValue(peerId, 1, "ILLUMINATION_2") * 0.5);
-		int32_t value3 = std::lround(getIntValue(peerId, 1, "ILLUMINATION_1") * 0.25);
-		if(value1 != i || (value3 != i && value3 != i - 1  && value3 != i + 1) || value2 != 0)
+		deletePeers();
+		std::cerr << "Wrong value returned (1)" << std::endl;
+		stopTests(1);
+	}
+
+	// {{{ Checks
+		for(auto& check : descriptor.checks)
 		{
-			retries--;
-			if(retries > 0)
+			bool success = false;
+			int32_t retryBudget = getRetryBudget();
+			std::vector<std::vector<double>> values;
+			for(int32_t retries = retryBudget; retries > 0 && !success; retries--)
 			{
-				std::cout << 'r';
-				continue;
+				TraceSpan attemptSpan(retries == retryBudget ? "Check" : "Retry", descriptor.eep);
+				int64_t sendTime = BaseLib::HelperFunctions::getTimeMicroseconds();
+				for(auto& frame : check.frames) sendPacket(getRadioPacket(getEepData(descriptor, frame), peers.front()->address));
+				std::vector<int64_t> latencies;
+				values = getInstanceValues(peers.front()->device, 1, variables, sendTime, latencies);
+				success = values.front() == check.expectedValues;
+				if(success) recordComparison(descriptor.eep, "check " + std::to_string(&check - descriptor.checks.data() + 1), variables, values, latencies);
+				recordStep(success, false);
+				if(!success)
+				{
+					Deviation deviation;
+					deviation.eep = descriptor.eep;
+					deviation.kind = values.front() == peers.front()->lastValues ? DeviationKind::lostFrame : DeviationKind::wrongValue;
+					deviation.attempt = retryBudget - retries + 1;
+					deviation.latency = latencies.front() / 1000;
+					recordDeviation(deviation);
+					std::cout << 'r' << std::flush;
+				}
 			}
-			std::cerr << "Wrong values returned for binary value " << i << ": " << value1 << ' ' << value2 << ' ' << value3 << std::endl;
-			deleteDevice(peerId);
-			exit(1);
+			if(!success)
+			{
+				deletePeers();
+				std::cerr << "Wrong value returned (2)" << std::endl;
+				stopTests(1);
+			}
+			peers.front()->lastValues = check.expectedValues;
+			peers.front()->lastInstanceValues = values;
 		}
-		retries = 5;
-		std::cout << (i > 0 ? "." : ".; done.\n") << std::flush;
-	}
+	// }}}
 
-	retries = 5;
-	for(int32_t i = 255; i >= 0; i--)
+	int64_t sendLatency = 0;
+	int64_t rpcLatency = 0;
+	auto getStride = [&](size_t pass) { return getSampleStride(descriptor.passes.at(pass), sampleSteps); };
+
+	size_t nextPass = 0;
+	int32_t nextIndex = descriptor.passes.empty() ? -1 : descriptor.passes.front().steps;
+	int32_t remaining = 0;
+	for(size_t i = 0; i < descriptor.passes.size(); i++) remaining += (descriptor.passes[i].steps + getStride(i) - 1) / getStride(i) + 1;
+	while(remaining > 0)
 	{
-		if(retries != 5) i++;
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)i, (char)(uint8_t)i, (char)(uint8_t)i, 0x09, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		int32_t value1 = std::lround(getDoubleValue(peerId, 1, "SUPPLY_VOLTAGE") * 50.0);
-		int32_t value2 = std::lround(getIntValue(peerId, 1, "ILLUMINATION_2") * 0.5);
-		int32_t value3 = std::lround(getIntValue(peerId, 1, "ILLUMINATION_1") * 0.25);
-		if(value1 != i || (value2 != i && value2 != i - 1  && value2 != i + 1) || value3 != 0)
+		checkTermination(); // Unwinding joins the peers' RPC threads
+
+		// {{{ Adapt pipeline depth
+			if(sendLatency > 0 && rpcLatency > 0)
+			{
+				size_t depth = std::max((int64_t)1, std::min((int64_t)_maxPipelineDepth, (rpcLatency + sendLatency - 1) / sendLatency + 1));
+				if(depth > peers.size() && remaining > (int32_t)peers.size() && !addPeer())
+				{
+					deletePeers();
+					std::cerr << "Wrong value returned (1)" << std::endl;
+					stopTests(1);
+				}
+			}
+		// }}}
+
+		// {{{ Send next step for each idle peer
+			for(size_t i = 0; i < peers.size(); i++)
+			{
+				SweepPeer& peer = *peers[i];
+				if(peer.busy) continue;
+				if(peer.index == -1)
+				{
+					if(nextIndex < 0 && nextPass + 1 < descriptor.passes.size())
+					{
+						nextPass++;
+						nextIndex = descriptor.passes.at(nextPass).steps;
+					}
+					if(nextIndex < 0) continue;
+					peer.pass = nextPass;
+					peer.index = nextIndex;
+					peer.stepStart = getTraceTime();
+					if(_workerStep && isMetricsEnabled()) _workerStep->set(descriptor.eep + " pass " + std::to_string(peer.pass + 1) + " step " + std::to_string(peer.index));
+					nextIndex = nextIndex == 0 ? -1 : std::max(0, nextIndex - getStride(nextPass));
+				}
+
+				sendFaults(peer.address);
+				peer.attemptStart = getTraceTime();
+				peer.sendTime = BaseLib::HelperFunctions::getTime();
+				int64_t startTime = BaseLib::HelperFunctions::getTimeMicroseconds();
+				sendPacket(getRadioPacket(getStepData(peer.pass, peer.index), peer.address));
+				int64_t latency = BaseLib::HelperFunctions::getTimeMicroseconds() - startTime;
+				sendLatency = sendLatency == 0 ? latency : (sendLatency * 7 + latency) / 8;
+
+				if(peer.thread.joinable()) peer.thread.join();
+				peer.busy = true;
+				const TestPeer* device = &peer.device;
+				int64_t sendTime = startTime;
+				peer.thread = std::thread([&, i, device, sendTime]()
+				{
+					setTraceThreadName("RPC");
+					SweepResult result;
+					result.peer = i;
+					int64_t startTime = BaseLib::HelperFunctions::getTimeMicroseconds();
+					try
+					{
+						result.instanceValues = getInstanceValues(*device, 1, variables, sendTime, result.instanceLatencies);
+						result.values = result.instanceValues.front();
+					}
+					catch(TestStop&)
+					{
+						result.stopped = true;
+					}
+					catch(BaseLib::Exception& ex)
+					{
+						std::cerr << ex.what() << std::endl;
+						setExitCode(1);
+						result.stopped = true;
+					}
+					catch(std::exception& ex)
+					{
+						std::cerr << ex.what() << std::endl;
+						setExitCode(1);
+						result.stopped = true;
+					}
+					result.latency = BaseLib::HelperFunctions::getTimeMicroseconds() - startTime;
+					std::lock_guard<std::mutex> resultGuard(resultMutex);
+					results.push_back(std::move(result));
+					resultConditionVariable.notify_one();
+				});
+			}
+		// }}}
+
+		SweepResult result;
+		{
+			std::unique_lock<std::mutex> resultGuard(resultMutex);
+			resultConditionVariable.wait(resultGuard, [&]() { return !results.empty(); });
+			result = std::move(results.front());
+			results.pop_front();
+		}
+		if(result.stopped) checkTermination();
+		rpcLatency = rpcLatency == 0 ? result.latency : (rpcLatency * 7 + result.latency) / 8;
+
+		SweepPeer& peer = *peers.at(result.peer);
+		peer.busy = false;
+		std::string stepName;
+		if(isTracing() || _instances.size() > 1) stepName = descriptor.eep + " pass " + std::to_string(peer.pass + 1) + " step " + std::to_string(peer.index);
+		if(isTracing() && peer.retrying) recordTraceSpan("Retry", stepName, peer.attemptStart, getTraceTime(), 0, getTraceId());
+		std::vector<Deviation> deviations;
+		bool success = checkStep(peer.pass, peer.index, result.values, deviations);
+		bool frameLost = !success && result.values == peer.lastValues;
+		if(frameLost) deviations = getStepDeviations(peer.pass, peer.index, DeviationKind::lostFrame);
+		for(auto& deviation : deviations)
+		{
+			if(!frameLost) deviation.kind = success ? DeviationKind::tolerated : DeviationKind::wrongValue;
+			deviation.attempt = peer.attempt;
+			deviation.latency = BaseLib::HelperFunctions::getTime() - peer.sendTime;
+			recordDeviation(deviation);
+		}
+		if(!success)
 		{
-			retries--;
-			if(retries > 0)
+			recordStep(false, frameLost);
+			peer.retrying = true;
+			peer.retries--;
+			peer.attempt++;
+			if(peer.retries > 0)
 			{
 				std::cout << 'r';
 				continue;
 			}
-			std::cerr << "Wrong values returned for binary value " << i << ": " << value1 << ' ' << value2 << ' ' << value3 << std::endl;
-			deleteDevice(peerId);
-			exit(1);
+			std::cerr << "Wrong values returned for binary value " << peer.index << ":";
+			for(size_t i = 0; i < result.values.size(); i++) std::cerr << ' ' << descriptor.fields.at(i).variable << '=' << result.values[i];
+			std::cerr << ". Expected raw values:";
+			for(size_t i = 0; i < descriptor.fields.size(); i++) std::cerr << ' ' << getStepRaw(descriptor.passes.at(peer.pass), i, descriptor.fields[i], peer.index);
+			std::cerr << std::endl;
+			printLinkQuality();
+			printDeviations();
+			deletePeers();
+			stopTests(1);
 		}
-		retries = 5;
-		std::cout << (i > 0 ? "." : ".; done.\n") << std::flush;
-	}
-	deleteDevice(peerId);
-}
-
-void testA50603()
-{
-	std::cout << std::endl << "Testing EEP A50603... Values should go from 0 lx to 1000 lx... " << std::endl;
-	uint64_t peerId = createDevice("A50603");
-
-	// {{{ LRN bit
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xC0, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xC0, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xC0, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		if(getDoubleValue(peerId, 1, "SUPPLY_VOLTAGE") != 0.0 || getIntValue(peerId, 1, "ILLUMINATION") != 0)
+		// An instance still returning its own previous values missed the frame and the step is sent again. Other values are
+		// a difference of that instance and recorded once, they say nothing about the radio link.
+		bool instanceMissedFrame = false;
+		for(size_t i = 1; i < result.instanceValues.size(); i++)
 		{
-			deleteDevice(peerId);
-			std::cerr << "Wrong value returned (1)" << std::endl;
-			exit(1);
+			if(result.instanceValues[i] != result.values && result.instanceValues[i] == peer.lastInstanceValues.at(i)) instanceMissedFrame = true;
 		}
-	// }}}
-
-	int32_t retries = 5;
-	for(int32_t i = 1000; i >= 0; i--)
-	{
-		if(retries != 5) i++;
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)(i / 4), (char)(uint8_t)(i >> 2), (char)(uint8_t)((i & 0x3) << 6), 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		int32_t value1 = std::lround(getDoubleValue(peerId, 1, "SUPPLY_VOLTAGE") * 50.0);
-		int32_t value2 = getIntValue(peerId, 1, "ILLUMINATION");
-		if(value1 != (i / 4) || value2 != i)
+		if(instanceMissedFrame)
 		{
-			retries--;
-			if(retries > 0)
+			recordStep(false, true);
+			for(auto& deviation : getStepDeviations(peer.pass, peer.index, DeviationKind::otherInstance))
+			{
+				deviation.attempt = peer.attempt;
+				deviation.latency = BaseLib::HelperFunctions::getTime() - peer.sendTime;
+				recordDeviation(deviation);
+			}
+			peer.retrying = true;
+			peer.retries--;
+			peer.attempt++;
+			if(peer.retries > 0)
 			{
 				std::cout << 'r';
 				continue;
 			}
-			std::cerr << "Wrong values returned for binary value " << i << ": " << value1 << ' ' << value2 << std::endl;
-			deleteDevice(peerId);
-			exit(1);
 		}
-		retries = 5;
-		std::cout << (i > 0 ? "." : ".; done.\n") << std::flush;
+		else recordStep(true, false);
+		recordComparison(descriptor.eep, stepName, variables, result.instanceValues, result.instanceLatencies);
+		if(isTracing()) recordTraceSpan("Step", stepName, peer.stepStart, getTraceTime(), 0, getTraceId());
+		peer.retrying = false;
+		{
+			std::lock_guard<std::recursive_mutex> linkQualityGuard(_linkQualityMutex);
+			_stepLatencies.push_back(BaseLib::HelperFunctions::getTime() - peer.sendTime);
+		}
+		_metrics->stepLatency.observe((BaseLib::HelperFunctions::getTime() - peer.sendTime) * 1000);
+		recordVerifiedStep(descriptor, descriptor.passes.at(peer.pass), peer.index);
+		peer.lastValues = std::move(result.values);
+		peer.lastInstanceValues = std::move(result.instanceValues);
+		peer.index = -1;
+		peer.retries = getRetryBudget();
+		peer.attempt = 1;
+		remaining--;
+		std::cout << (remaining > 0 ? "." : ".; done.\n") << std::flush;
 	}
 
-	deleteDevice(peerId);
+	deletePeers();
 }
 
-void testA50604()
+int main(int argc, char* argv[])
 {
-	std::cout << std::endl << "Testing EEP A50604... Values should go from 0 lx to 65535 lx and -20 °C to 60 °C... " << std::endl;
-	uint64_t peerId = createDevice("A50604");
-
-	// {{{ LRN bit
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x0B, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x0B, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x0B, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xF3, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xF3, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xF3, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		if(getDoubleValue(peerId, 1, "TEMPERATURE") != -20.0 || getIntValue(peerId, 1, "ILLUMINATION") != 0 || getIntValue(peerId, 1, "ENERGY_STORAGE") != 0)
+	if(argc >= 2 && std::string(argv[1]) == "--oracle")
+	{
+		std::string directory("/etc/homegear/devices/15");
+		for(int32_t i = 2; i < argc; i++)
 		{
-			deleteDevice(peerId);
-			std::cerr << "Wrong value returned (1)" << std::endl;
-			exit(1);
+			std::string argument(argv[i]);
+			if(argument == "--index" && i + 1 < argc) _indexFilename = std::string(argv[++i]);
+			else directory = argument;
 		}
-	// }}}
+		return testOracle(directory) == 0 ? 0 : 1;
+	}
 
-	int32_t retries = 5;
-	for(int32_t i = 1023; i >= 0; i--)
+	if(argc < 3)
 	{
-		int32_t illuminance = std::lround(i * 64.06158357);
-		if(retries != 5) i++;
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)(i / 4), (char)(uint8_t)(illuminance >> 8), (char)(uint8_t)(illuminance & 0xFF), (char)(uint8_t)(((i % 16) << 4) | 0x0B), _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		int32_t value1 = std::lround((getDoubleValue(peerId, 1, "TEMPERATURE") + 20.0) * 3.125);
-		int32_t value2 = getIntValue(peerId, 1, "ILLUMINATION");
-		int32_t value3 = std::lround(getIntValue(peerId, 1, "ENERGY_STORAGE") * 0.15);
-		if(value1 != (i / 4) || value2 != illuminance || value3 != (i % 16))
+		printHelp();
+		exit(1);
+	}
+	
+	std::string gateway(argv[1]);
+	if(!isTransportAddress(gateway))
+	{
+		std::cerr << "Invalid gateway." << std::endl;
+		printHelp();
+		exit(1);
+	}
+	std::cout << "Gateway set to " << gateway << std::endl;
+
+	_instances.push_back(HomegearInstance{ "", std::string(argv[2]) });
+	std::cout << "EnOcean interface set to " << _instances.front().interface << std::endl;
+
+	std::string traceFilename;
+	std::string metricsFilename;
+
+	for(int32_t i = 3; i < argc; i++)
+	{
+		std::string argument(argv[i]);
+		if(argument == "--faults" && i + 1 < argc)
 		{
-			retries--;
-			if(retries > 0)
+			for(auto& rate : BaseLib::HelperFunctions::splitAll(std::string(argv[++i]), ',')) _faultRates.push_back(BaseLib::Math::getDouble(rate));
+		}
+		else if(argument == "--esp3-faults") _esp3Faults = true;
+		else if(argument == "--sample" && i + 1 < argc) _sampleSteps = BaseLib::Math::getNumber(std::string(argv[++i]));
+		else if(argument == "--workers" && i + 1 < argc) _workerCount = std::max((int64_t)1, BaseLib::Math::getNumber(std::string(argv[++i])));
+		else if(argument == "--rpc-slots" && i + 1 < argc) _rpc.setCapacity(std::max((int64_t)1, BaseLib::Math::getNumber(std::string(argv[++i]))));
+		else if(argument == "--budget" && i + 1 < argc)
+		{
+			std::string budget(argv[++i]);
+			char* unit = nullptr;
+			double value = std::strtod(budget.c_str(), &unit);
+			std::string unitString(unit);
+			int64_t factor = 0;
+			if(unitString.empty() || unitString == "s") factor = 1000;
+			else if(unitString == "m") factor = 60000;
+			else if(unitString == "h") factor = 3600000;
+			if(unit == budget.c_str() || factor == 0 || !(value > 0))
 			{
-				std::cout << 'r';
-				continue;
+				std::cerr << "Invalid budget: " << budget << std::endl;
+				printHelp();
+				exit(1);
 			}
-			std::cerr << "Wrong values returned for binary value " << i << ": " << value1 << ' ' << value2 << ' ' << value3 << ". Expected: " << (i / 4) << ' ' << illuminance << ' ' << (i % 16) << std::endl;
-			deleteDevice(peerId);
+			_budget = value * factor;
+		}
+		else if(argument == "--index" && i + 1 < argc) _indexFilename = std::string(argv[++i]);
+		else if(argument == "--history" && i + 1 < argc) _historyFilename = std::string(argv[++i]);
+		else if(argument == "--deviations" && i + 1 < argc) _deviationsFilename = std::string(argv[++i]);
+		else if(argument == "--compare" && i + 2 < argc)
+		{
+			_instances.push_back(HomegearInstance{ std::string(argv[i + 1]), std::string(argv[i + 2]) });
+			i += 2;
+		}
+		else if(argument == "--trace" && i + 1 < argc) traceFilename = std::string(argv[++i]);
+		else if(argument == "--metrics" && i + 1 < argc) metricsFilename = std::string(argv[++i]);
+		else if(argument == "--eeps" && i + 1 < argc) _eepFilter = BaseLib::HelperFunctions::splitAll(std::string(argv[++i]), ',');
+		else
+		{
+			std::cerr << "Invalid option: " << argument << std::endl;
+			printHelp();
 			exit(1);
 		}
-		retries = 5;
-		std::cout << (i > 0 ? "." : ".; done.\n") << std::flush;
 	}
 
-	deleteDevice(peerId);
+	if(!traceFilename.empty())
+	{
+		startTrace(traceFilename);
+		setTraceThreadName("Main");
+		_transportTrack = addTraceTrack("Gateway " + gateway);
+	}
+
+	if(!metricsFilename.empty()) startMetrics(metricsFilename, "homegear-enocean-tests");
+	_metrics.reset(new TestMetrics(_workerCount));
+	updateSendDelayMetrics();
+
+	std::unique_ptr<BaseLib::SharedObjects> bl(new BaseLib::SharedObjects(std::string(""), nullptr, false));
+	try
+	{
+		_transport = createTransport(gateway, bl.get());
+		_transport->open();
+
+		struct sigaction signalAction{};
+		signalAction.sa_handler = handleSignal;
+		sigemptyset(&signalAction.sa_mask);
+		sigaction(SIGINT, &signalAction, nullptr);
+		sigaction(SIGTERM, &signalAction, nullptr);
+		std::atexit(deleteCreatedPeers);
+
+		getAddress();
+		deleteLeftoverPeers();
+
+		if(_faultRates.empty()) runTests();
+		else testFaults();
+
+		printLinkQuality();
+	}
+	catch(TestStop&)
+	{
+		// All tests are left and their threads joined, so the remaining peers can be deleted by deleteCreatedPeers()
+		if(_transport) _transport->close();
+		exit(_exitCode);
+	}
+	catch(BaseLib::Exception& ex)
+	{
+		std::cerr << ex.what() << std::endl;
+		exit(1);
+	}
+	catch(std::exception& ex)
+	{
+		std::cerr << ex.what() << std::endl;
+		exit(1);
+	}
+
+	_transport->close();
+
+	return 0;
+}
+
+TestRunner::TestRunner(int32_t workerCount)
+{
+	for(int32_t i = 0; i < workerCount; i++) _workers.push_back(std::unique_ptr<Worker>(new Worker()));
 }
 
-void testA50605()
+void TestRunner::add(TestTask task)
 {
-	std::cout << std::endl << "Testing EEP A50605... Values should go from 0 lx to 5100 lx for ILLUMINATION2 and from 0 lx to 10200 lx for ILLUMINATION1... " << std::endl;
-	uint64_t peerId = createDevice("A50605");
+	_tasks.push_back(std::move(task));
+}
 
-	// {{{ LRN bit
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		if(getDoubleValue(peerId, 1, "SUPPLY_VOLTAGE") != 0.0 || getIntValue(peerId, 1, "ILLUMINATION_1") != 0.0 || getIntValue(peerId, 1, "ILLUMINATION_2") != 0.0)
-		{
-			deleteDevice(peerId);
-			std::cerr << "Wrong value returned (1)" << std::endl;
-			exit(1);
-		}
-	// }}}
+/**
+ * Picks a coverage level for every test so that the estimated duration fits into budget milliseconds, spread over all
+ * workers. Tests are visited by priority: First every test gets its cheapest level as long as that fits, tests that
+ * don't fit anymore are dropped. The remaining time is then used to raise the levels, again by priority. Without a
+ * budget all tests run with full coverage.
+ */
+void TestRunner::plan(int64_t budget)
+{
+	for(auto& task : _tasks) task.level = task.costs.size() - 1;
+	if(budget <= 0) return;
+
+	std::stable_sort(_tasks.begin(), _tasks.end(), [](const TestTask& a, const TestTask& b) { return a.priority > b.priority; });
+	// All frames go through one gateway and its duty cycle wait, so more workers don't add radio time
+	int64_t available = budget;
+	std::vector<TestTask> tasks;
+	for(auto& task : _tasks)
+	{
+		if(task.costs.front() > available) continue;
+		available -= task.costs.front();
+		task.level = 0;
+		tasks.push_back(std::move(task));
+	}
+	_tasks.swap(tasks);
 
-	int32_t retries = 5;
-	for(int32_t i = 255; i >= 0; i--)
+	for(bool upgraded = true; upgraded;)
 	{
-		if(retries != 5) i++;
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)i, (char)(uint8_t)i, (char)(uint8_t)i, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		int32_t value1 = std::lround(getDoubleValue(peerId, 1, "SUPPLY_VOLTAGE") * 50.0);
-		int32_t value2 = std::lround(getIntValue(peerId, 1, "ILLUMINATION_2") * 0.05);
-		int32_t value3 = std::lround(getIntValue(peerId, 1, "ILLUMINATION_1") * 0.025);
-		if(value1 != i || (value3 != i && value3 != i - 1  && value3 != i + 1) || value2 != 0)
+		upgraded = false;
+		for(auto& task : _tasks)
 		{
-			retries--;
-			if(retries > 0)
-			{
-				std::cout << 'r';
-				continue;
-			}
-			std::cerr << "Wrong values returned for binary value " << i << ": " << value1 << ' ' << value2 << ' ' << value3 << std::endl;
-			deleteDevice(peerId);
-			exit(1);
+			if(task.level + 1 >= task.costs.size()) continue;
+			int64_t additionalCost = task.costs[task.level + 1] - task.costs[task.level];
+			if(additionalCost > available) continue;
+			available -= additionalCost;
+			task.level++;
+			upgraded = true;
 		}
-		retries = 5;
-		std::cout << (i > 0 ? "." : ".; done.\n") << std::flush;
 	}
 
-	retries = 5;
-	for(int32_t i = 255; i >= 0; i--)
+	int64_t plannedCost = 0;
+	std::cout << "Test plan for a budget of " << (budget / 1000) << " s:" << std::endl;
+	for(auto& task : _tasks)
 	{
-		if(retries != 5) i++;
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)i, (char)(uint8_t)i, (char)(uint8_t)i, 0x09, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		int32_t value1 = std::lround(getDoubleValue(peerId, 1, "SUPPLY_VOLTAGE") * 50.0);
-		int32_t value2 = std::lround(getIntValue(peerId, 1, "ILLUMINATION_2") * 0.05);
-		int32_t value3 = std::lround(getIntValue(peerId, 1, "ILLUMINATION_1") * 0.025);
-		if(value1 != i || (value2 != i && value2 != i - 1  && value2 != i + 1) || value3 != 0)
-		{
-			retries--;
-			if(retries > 0)
-			{
-				std::cout << 'r';
-				continue;
-			}
-			std::cerr << "Wrong values returned for binary value " << i << ": " << value1 << ' ' << value2 << ' ' << value3 << std::endl;
-			deleteDevice(peerId);
-			exit(1);
-		}
-		retries = 5;
-		std::cout << (i > 0 ? "." : ".; done.\n") << std::flush;
+		plannedCost += task.costs[task.level];
+		std::cout << "  " << task.name << ": priority " << task.priority << ", coverage level " << (task.level + 1) << "/" << task.costs.size() << ", about " << (task.costs[task.level] / 1000) << " s" << std::endl;
 	}
-	deleteDevice(peerId);
+	std::cout << _tasks.size() << " tests planned, about " << (plannedCost / 1000) << " s." << std::endl;
 }
 
-void testA50701()
+/**
+ * Hands out the tests round robin in order of increasing priority and cost, so every worker starts with its most
+ * important and most expensive test and thieves take the cheap ones from the front.
+ */
+void TestRunner::run()
 {
-	std::cout << std::endl << "Testing EEP A50701..." << std::endl;
-	uint64_t peerId = createDevice("A50701");
+	std::stable_sort(_tasks.begin(), _tasks.end(), [](const TestTask& a, const TestTask& b) { return a.priority < b.priority || (a.priority == b.priority && a.costs[a.level] < b.costs[b.level]); });
+	for(size_t i = 0; i < _tasks.size(); i++) _workers[i % _workers.size()]->tasks.push_back(std::move(_tasks[i]));
+	_tasks.clear();
 
-	// {{{ LRN bit
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, 0, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, 0, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)0xFF, 0, (char)(uint8_t)0xFF, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		if(getDoubleValue(peerId, 1, "SUPPLY_VOLTAGE") != 0.0 || getBooleanValue(peerId, 1, "MOTION") != false)
+	int64_t startTime = BaseLib::HelperFunctions::getTime();
+	for(size_t i = 0; i < _workers.size(); i++) _workers[i]->thread = std::thread(&TestRunner::work, this, i);
+	for(auto& worker : _workers) worker->thread.join();
+
+	std::cout << std::endl << "Test durations:" << std::endl;
+	for(auto& duration : _durations) std::cout << "  " << duration.first << ": " << (duration.second / 1000) << " s" << std::endl;
+	std::cout << _durations.size() << " tests done in " << ((BaseLib::HelperFunctions::getTime() - startTime) / 1000) << " s with " << _workers.size() << " workers." << std::endl;
+}
+
+bool TestRunner::getTask(size_t workerIndex, TestTask& task)
+{
+	{
+		Worker& worker = *_workers[workerIndex];
+		std::lock_guard<std::mutex> workerGuard(worker.mutex);
+		if(!worker.tasks.empty())
 		{
-			deleteDevice(peerId);
-			std::cerr << "Wrong value returned (1)" << std::endl;
-			exit(1);
+			task = std::move(worker.tasks.back());
+			worker.tasks.pop_back();
+			return true;
 		}
-	// }}}
+	}
 
-	int32_t retries = 5;
-	for(int32_t i = 250; i >= 0; i--)
+	for(size_t i = 1; i < _workers.size(); i++)
 	{
-		if(retries != 5) i++;
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)i, 0, (char)(uint8_t)i, 0x09, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		int32_t value1 = std::lround(getDoubleValue(peerId, 1, "SUPPLY_VOLTAGE") * 50.0);
-		bool value2 = getBooleanValue(peerId, 1, "MOTION");
-		if(value1 != i || (i <= 127 && value2 != false) || (i >= 128 && value2 != true))
+		Worker& victim = *_workers[(workerIndex + i) % _workers.size()];
+		std::lock_guard<std::mutex> victimGuard(victim.mutex);
+		if(victim.tasks.empty()) continue;
+		task = std::move(victim.tasks.front());
+		victim.tasks.pop_front();
+		return true;
+	}
+	return false;
+}
+
+void TestRunner::work(size_t workerIndex)
+{
+	setTraceThreadName("Worker " + std::to_string(workerIndex + 1));
+	_workerStep = _metrics->workerSteps.at(workerIndex);
+	TestTask task;
+	while(getTask(workerIndex, task))
+	{
+		try
 		{
-			retries--;
-			if(retries > 0)
+			checkTermination();
+			int64_t startTime = BaseLib::HelperFunctions::getTime();
+			if(isMetricsEnabled()) _workerStep->set(task.name);
 			{
-				std::cout << 'r';
-				continue;
+				TraceSpan testSpan("Test", isTracing() ? task.name + " level " + std::to_string(task.level + 1) : "");
+				ResourceGuard linkGuard(_link, task.linkUnits);
+				task.run(task.level);
 			}
-			std::cerr << "Wrong values returned for binary value " << i << ": " << value1 << ' ' << value2 << std::endl;
-			deleteDevice(peerId);
-			exit(1);
+			_metrics->tests.fetch_add(1, std::memory_order_relaxed);
+			std::lock_guard<std::mutex> resultsGuard(_resultsMutex);
+			_durations.push_back(std::make_pair(task.name, BaseLib::HelperFunctions::getTime() - startTime));
+		}
+		catch(TestStop&)
+		{
+			return; // The test unwound and deleted its peers, run() joins this worker
+		}
+		catch(BaseLib::Exception& ex)
+		{
+			// Unwound like a TestStop. Uncaught, it would terminate the process without deleting any peers.
+			std::cerr << ex.what() << std::endl;
+			setExitCode(1);
+			return;
+		}
+		catch(std::exception& ex)
+		{
+			std::cerr << ex.what() << std::endl;
+			setExitCode(1);
+			return;
 		}
-		retries = 5;
-		std::cout << (i > 0 ? "." : ".; done.\n") << std::flush;
 	}
+}
 
-	deleteDevice(peerId);
+void runTests()
+{
+	_link.setCapacity(_workerCount);
+	loadHistory();
+	TestRunner runner(_workerCount);
+	testF6(runner);
+	testD5(runner);
+	testA5(runner);
+	testD2(runner);
+	runner.plan(_budget);
+	runner.run();
+	checkTermination(); // All workers are joined, main() exits if one of them stopped the run
+	printComparison();
+	printDeviations();
 }
 
-void testA53801()
+void loadHistory()
 {
-	std::cout << std::endl << "Testing EEP A53801... " << std::endl;
-	uint64_t peerId = createDevice("A53801");
+	std::lock_guard<std::mutex> historyGuard(_historyMutex);
+	std::ifstream file(_historyFilename);
+	std::string name;
+	TestHistory history;
+	while(file >> name >> history.millisecondsPerFrame >> history.lastStart >> history.lastSuccess) _history[name] = history;
+}
 
-	setValue(peerId, 1, "PAIRING", 2);
+/**
+ * Rewrites the whole file. It is saved at the start of every test, so a test that never finishes because its check
+ * failed or the run was interrupted is remembered as failed.
+ */
+void saveHistory()
+{
+	std::string temporaryFilename = _historyFilename + ".tmp";
+	{
+		std::ofstream file(temporaryFilename, std::ios::trunc);
+		for(auto& entry : _history) file << entry.first << ' ' << entry.second.millisecondsPerFrame << ' ' << entry.second.lastStart << ' ' << entry.second.lastSuccess << '\n';
+	}
+	rename(temporaryFilename.c_str(), _historyFilename.c_str());
+}
 
-	int64_t startTime = BaseLib::HelperFunctions::getTime();
-	std::vector<char> packet;
+void recordTestStart(const std::string& name)
+{
+	std::lock_guard<std::mutex> historyGuard(_historyMutex);
+	_history[name].lastStart = BaseLib::HelperFunctions::getTime();
+	saveHistory();
+}
 
-	while(BaseLib::HelperFunctions::getTime() < startTime + 100)
+void recordTestSuccess(const std::string& name, int64_t duration, int64_t frames)
+{
+	std::lock_guard<std::mutex> historyGuard(_historyMutex);
+	TestHistory& history = _history[name];
+	double millisecondsPerFrame = (double)duration / std::max((int64_t)1, frames);
+	history.millisecondsPerFrame = history.millisecondsPerFrame == 0 ? millisecondsPerFrame : history.millisecondsPerFrame * 0.7 + millisecondsPerFrame * 0.3;
+	history.lastSuccess = BaseLib::HelperFunctions::getTime();
+	saveHistory();
+}
+
+/**
+ * Modification times of Homegear's device descriptions by EEP in milliseconds.
+ */
+std::map<std::string, int64_t> getDescriptionTimes()
+{
+	std::map<std::string, int64_t> times;
+	for(auto& device : loadDeviceDescriptions(_descriptionDirectory, _indexFilename))
 	{
-		readPacket(); // Clear buffer
+		struct stat fileInfo;
+		if(stat((_descriptionDirectory + '/' + device.filename).c_str(), &fileInfo) == 0) times[device.eep] = (int64_t)fileInfo.st_mtime * 1000;
 	}
+	return times;
+}
 
-	startTime = BaseLib::HelperFunctions::getTime();
-	setValue(peerId, 1, "STATE", true);
-	while(packet.size() != 24 && BaseLib::HelperFunctions::getTime() < startTime + 2000)
+/**
+ * 2: The test failed or was interrupted the last time it ran.
+ * 1: The test never passed or Homegear's description of the EEP changed since it last passed.
+ * 0: Everything else.
+ */
+int32_t getTestPriority(const std::string& name, const std::map<std::string, int64_t>& descriptionTimes)
+{
+	std::lock_guard<std::mutex> historyGuard(_historyMutex);
+	auto historyIterator = _history.find(name);
+	if(historyIterator == _history.end() || historyIterator->second.lastSuccess == 0) return 1;
+	if(historyIterator->second.lastStart > historyIterator->second.lastSuccess) return 2;
+	auto timeIterator = descriptionTimes.find(name);
+	if(timeIterator != descriptionTimes.end() && timeIterator->second > historyIterator->second.lastSuccess) return 1;
+	return 0;
+}
+
+void addEepTest(TestRunner& runner, const std::string& eep)
+{
+	if(!_eepFilter.empty() && std::find(_eepFilter.begin(), _eepFilter.end(), eep) == _eepFilter.end()) return;
+	const EepDescriptor* descriptor = findEepDescriptor(eep);
+	if(!descriptor)
+	{
+		std::cerr << "No descriptor for EEP " << eep << "." << std::endl;
+		stopTests(1);
+	}
+
+	static std::map<std::string, int64_t> descriptionTimes = _budget > 0 ? getDescriptionTimes() : std::map<std::string, int64_t>();
+	double millisecondsPerFrame = 0;
+	{
+		std::lock_guard<std::mutex> historyGuard(_historyMutex);
+		auto historyIterator = _history.find(eep);
+		if(historyIterator != _history.end()) millisecondsPerFrame = historyIterator->second.millisecondsPerFrame;
+	}
+	if(millisecondsPerFrame <= 0) millisecondsPerFrame = 250; // Rough value for a first run
+
+	// Coverage levels: about 4, 16 and 64 steps per pass, then every step. Levels not cheaper than the next one are
+	// left out. --sample caps the highest level.
+	std::vector<int32_t> levels;
+	std::vector<int64_t> costs;
+	for(int32_t sampleSteps : { 4, 16, 64, 0 })
 	{
-		packet = readPacket();
+		if(_sampleSteps > 0 && (sampleSteps == 0 || sampleSteps > _sampleSteps)) sampleSteps = _sampleSteps;
+		int64_t frames = getFrameCount(*descriptor, sampleSteps);
+		if(!levels.empty() && frames <= getFrameCount(*descriptor, levels.back())) continue;
+		levels.push_back(sampleSteps);
+		costs.push_back((int64_t)(millisecondsPerFrame * frames));
 	}
+
+	std::string name = eep;
+	runner.add(TestTask{ eep, 1, getTestPriority(eep, descriptionTimes), costs, [descriptor, levels, name](size_t level)
+	{
+		int64_t startTime = BaseLib::HelperFunctions::getTime();
+		recordTestStart(name);
+		testEep(*descriptor, levels.at(level));
+		recordTestSuccess(name, BaseLib::HelperFunctions::getTime() - startTime, getFrameCount(*descriptor, levels.at(level)));
+	}, 0 });
+}
+
+/**
+ * Adds a test that waits for frames sent by Homegear. It takes all units of _link, so no other test sends frames or
+ * drains the input while it waits.
+ */
+void addLinkTest(TestRunner& runner, const std::string& eep, int64_t cost, void (*test)())
+{
+	if(!_eepFilter.empty() && std::find(_eepFilter.begin(), _eepFilter.end(), eep) == _eepFilter.end()) return;
+	static std::map<std::string, int64_t> descriptionTimes = _budget > 0 ? getDescriptionTimes() : std::map<std::string, int64_t>();
+	{
+		std::lock_guard<std::mutex> historyGuard(_historyMutex);
+		auto historyIterator = _history.find(eep);
+		if(historyIterator != _history.end() && historyIterator->second.millisecondsPerFrame > 0) cost = (int64_t)historyIterator->second.millisecondsPerFrame; // Recorded as a single frame
+	}
+
+	std::string name = eep;
+	runner.add(TestTask{ eep, _link.capacity(), getTestPriority(eep, descriptionTimes), { cost }, [name, test](size_t)
+	{
+		int64_t startTime = BaseLib::HelperFunctions::getTime();
+		recordTestStart(name);
+		test();
+		recordTestSuccess(name, BaseLib::HelperFunctions::getTime() - startTime, 1);
+	}, 0 });
+}
+
+void testA53801()
+{
+	std::cout << std::endl << "Testing EEP A53801... " << std::endl;
+	TestPeer peer("A53801");
+	uint64_t peerId = peer.id();
+
+	setValue(peerId, 1, "PAIRING", 2);
+
+	std::vector<char> packet;
+	flushInput();
+
+	setValue(peerId, 1, "STATE", true);
+	packet = waitForPacket([](const std::vector<char>& response) { return response.size() == 24; }, BaseLib::HelperFunctions::getTime() + 2000);
 	if(packet.empty() || packet.at(10) != 9 || (packet.at(14) & 0x7F) != 2)
 	{
 		std::cerr << "Wrong value received for value \"true\": " << BaseLib::HelperFunctions::getHexString(packet) << std::endl;
-		deleteDevice(peerId);
-		exit(1);
+		stopTests(1);
 	}
 
-	packet.clear();
-	startTime = BaseLib::HelperFunctions::getTime();
 	setValue(peerId, 1, "STATE", false);
-	while(packet.size() != 24 && BaseLib::HelperFunctions::getTime() < startTime + 2000)
-	{
-		packet = readPacket();
-	}
+	packet = waitForPacket([](const std::vector<char>& response) { return response.size() == 24; }, BaseLib::HelperFunctions::getTime() + 2000);
 	if(packet.empty() || packet.at(10) != 8 || (packet.at(14) & 0x7F) != 2)
 	{
 		std::cerr << "Wrong value received for value \"false\": " << BaseLib::HelperFunctions::getHexString(packet) << std::endl;
-		deleteDevice(peerId);
-		exit(1);
+		stopTests(1);
 	}
 
-	packet.clear();
-	startTime = BaseLib::HelperFunctions::getTime();
 	setValue(peerId, 1, "STATE", true);
-	while(packet.size() != 24 && BaseLib::HelperFunctions::getTime() < startTime + 2000)
-	{
-		packet = readPacket();
-	}
+	packet = waitForPacket([](const std::vector<char>& response) { return response.size() == 24; }, BaseLib::HelperFunctions::getTime() + 2000);
 	if(packet.empty() || packet.at(10) != 9 || (packet.at(14) & 0x7F) != 2)
 	{
 		std::cerr << "Wrong value received for value \"true\": " << BaseLib::HelperFunctions::getHexString(packet) << std::endl;
-		deleteDevice(peerId);
-		exit(1);
+		stopTests(1);
 	}
-
-	deleteDevice(peerId);
 }
 
 void testA53802()
 {
 	std::cout << std::endl << "Testing EEP A53802... " << std::endl;
-	uint64_t peerId = createDevice("A53802");
+	TestPeer peer("A53802");
+	uint64_t peerId = peer.id();
 
 	setValue(peerId, 1, "PAIRING", 2);
 
-	// {{{ LRN bit
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 2, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 2, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 2, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 2, (char)(uint8_t)0xFF, 0, 1, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 2, (char)(uint8_t)0xFF, 0, 1, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 2, (char)(uint8_t)0xFF, 0, 1, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		if(getIntValue(peerId, 1, "LEVEL") != 0)
+	// {{{ Teach-in
+		if(!teachIn(peer, "A53802", std::vector<char>{ (char)(uint8_t)0xA5, 2, 0, 0, 0x08 }, { "LEVEL" }, { 0 }))
 		{
-			deleteDevice(peerId);
 			std::cerr << "Wrong value returned (1)" << std::endl;
-			exit(1);
+			stopTests(1);
 		}
 	// }}}
 
-	int64_t startTime = BaseLib::HelperFunctions::getTime();
 	std::vector<char> packet;
+	flushInput();
 
-	while(BaseLib::HelperFunctions::getTime() < startTime + 100)
-	{
-		readPacket(); // Clear buffer
-	}
-
-	packet.clear();
-	startTime = BaseLib::HelperFunctions::getTime();
 	setValue(peerId, 1, "LEVEL", 0);
-	while(packet.size() != 24 && BaseLib::HelperFunctions::getTime() < startTime + 2000)
-	{
-		packet = readPacket();
-	}
+	packet = waitForPacket([](const std::vector<char>& response) { return response.size() == 24; }, BaseLib::HelperFunctions::getTime() + 2000);
 	if(packet.empty() || packet.at(10) != 8 || (packet.at(14) & 0x7F) != 2)
 	{
 		std::cerr << "Wrong value received for value \"0\": " << BaseLib::HelperFunctions::getHexString(packet) << std::endl;
-		deleteDevice(peerId);
-		exit(1);
+		stopTests(1);
 	}
 
 	for(int32_t i = 2; i <= 255; i++)
 	{
-		packet.clear();
-		startTime = BaseLib::HelperFunctions::getTime();
 		setValue(peerId, 1, "RAMPING_TIME", i);
 		setValue(peerId, 1, "LEVEL", (int32_t)std::lround(i / 2.55));
-		while(packet.size() != 24 && BaseLib::HelperFunctions::getTime() < startTime + 2000)
-		{
-			packet = readPacket();
-		}
+		packet = waitForPacket([](const std::vector<char>& response) { return response.size() == 24; }, BaseLib::HelperFunctions::getTime() + 2000);
 		if(packet.empty() || packet.at(8) != (char)(uint8_t)std::lround(std::lround(i / 2.55) * 2.55) || packet.at(9) != (char)(uint8_t)i || packet.at(10) != 9 || (packet.at(14) & 0x7F) != 2)
 		{
 			std::cerr << "Wrong value received for value \"" << i << "\" (expected \"0x" << std::hex << std::lround(std::lround(i / 2.55) * 2.55) << "\"): " << BaseLib::HelperFunctions::getHexString(packet) << std::endl;
-			deleteDevice(peerId);
-			exit(1);
+			stopTests(1);
 		}
 	}
+}
+
+void testA5(TestRunner& runner)
+{
+	addEepTest(runner, "A50201");
+	addEepTest(runner, "A50202");
+	addEepTest(runner, "A50203");
+	addEepTest(runner, "A50204");
+	addEepTest(runner, "A50205");
+	addEepTest(runner, "A50206");
+	addEepTest(runner, "A50207");
+	addEepTest(runner, "A50208");
+	addEepTest(runner, "A50209");
+	addEepTest(runner, "A5020A");
+	addEepTest(runner, "A5020B");
+	addEepTest(runner, "A50210");
+	addEepTest(runner, "A50211");
+	addEepTest(runner, "A50212");
+	addEepTest(runner, "A50213");
+	addEepTest(runner, "A50214");
+	addEepTest(runner, "A50215");
+	addEepTest(runner, "A50216");
+	addEepTest(runner, "A50217");
+	addEepTest(runner, "A50218");
+	addEepTest(runner, "A50219");
+	addEepTest(runner, "A5021A");
+	addEepTest(runner, "A5021B");
+	addEepTest(runner, "A50220");
+	addEepTest(runner, "A50230");
+	addEepTest(runner, "A50401");
+	addEepTest(runner, "A50402");
+	addEepTest(runner, "A50403");
+	addEepTest(runner, "A50501");
+	addEepTest(runner, "A50601");
+	addEepTest(runner, "A50602");
+	addEepTest(runner, "A50603");
+	addEepTest(runner, "A50604");
+	addEepTest(runner, "A50605");
+	addEepTest(runner, "A50701");
+	addLinkTest(runner, "A53801", 10000, testA53801);
+	addLinkTest(runner, "A53802", 300000, testA53802);
+}
+
+void testF6(TestRunner&)
+{
+	// F6-02-01 rocker switches send button events, not value ranges, so they have no EEP descriptor yet.
+}
 
-	deleteDevice(peerId);
-}
-
-void testA5()
-{
-	/*testA502("A50201", 255, 0, 6.375);
-	testA502("A50202", 255, 10, 6.375);
-	testA502("A50203", 255, 20, 6.375);
-	testA502("A50204", 255, 30, 6.375);
-	testA502("A50205", 255, 40, 6.375);
-	testA502("A50206", 255, 50, 6.375);
-	testA502("A50207", 255, 60, 6.375);
-	testA502("A50208", 255, 70, 6.375);
-	testA502("A50209", 255, 80, 6.375);
-	testA502("A5020A", 255, 90, 6.375);
-	testA502("A5020B", 255, 100, 6.375);
-	testA502("A50210", 255, 20, 3.1875);
-	testA502("A50211", 255, 30, 3.1875);
-	testA502("A50212", 255, 40, 3.1875);
-	testA502("A50213", 255, 50, 3.1875);
-	testA502("A50214", 255, 60, 3.1875);
-	testA502("A50215", 255, 70, 3.1875);
-	testA502("A50216", 255, 80, 3.1875);
-	testA502("A50217", 255, 90, 3.1875);
-	testA502("A50218", 255, 100, 3.1875);
-	testA502("A50219", 255, 110, 3.1875);
-	testA502("A5021A", 255, 120, 3.1875);
-	testA502("A5021B", 255, 130, 3.1875);
-	testA502("A50220", 1023, 41.2, 20);
-	testA502("A50230", 1023, 62.3, 10);
-	testA50401();
-	testA50402();
-	testA50403();
-	testA50501();
-	testA50601();
-	testA50602();
-	testA50603();
-	testA50604();
-	testA50605();*/
-	testA50701();
-	/*testA53801();
-	testA53802();*/
-}
-
-void testF60201()
-{
-	std::cout << std::endl << "Testing EEP F60201... " << std::endl;
-	uint64_t peerId = createDevice("F60201");
-
-	// {{{ LRN bit
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0, 0, 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0x03, (char)(uint8_t)0xFF, 0, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0x03, (char)(uint8_t)0xFF, 0, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, 0x03, (char)(uint8_t)0xFF, 0, 0, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		if(getDoubleValue(peerId, 1, "PRESSURE") != 500)
+void testD5(TestRunner& runner)
+{
+	addEepTest(runner, "D50001");
+}
+
+/**
+ * The fields of these profiles are combined pairwise instead of sweeping every raw value, see getCoveringArray().
+ */
+void testD2(TestRunner& runner)
+{
+	addEepTest(runner, "D23200");
+	addEepTest(runner, "D23201");
+	addEepTest(runner, "D23202");
+}
+
+/**
+ * Runs the same sweep once per fault rate and compares ingestion throughput and latency of the valid frames.
+ */
+void testFaults()
+{
+	struct FaultRun
+	{
+		double rate = 0;
+		int64_t faults = 0;
+		int64_t steps = 0;
+		int64_t retries = 0;
+		int64_t duration = 0;
+		int64_t averageLatency = 0;
+		int64_t p95Latency = 0;
+	};
+	std::vector<FaultRun> runs;
+
+	for(auto rate : _faultRates)
+	{
+		_faultRate = rate;
+		std::fill(_faultsSent, _faultsSent + (int32_t)FaultType::count, 0);
+		_stepLatencies.clear();
+		int64_t retries = _linkQuality.retries;
+		int64_t startTime = BaseLib::HelperFunctions::getTime();
+
+		std::cout << std::endl << "Fault rate " << rate << ":";
+		testEep("A50201");
+
+		FaultRun run;
+		run.rate = rate;
+		run.duration = BaseLib::HelperFunctions::getTime() - startTime;
+		for(auto faults : _faultsSent) run.faults += faults;
+		run.steps = _stepLatencies.size();
+		run.retries = _linkQuality.retries - retries;
+		if(!_stepLatencies.empty())
 		{
-			deleteDevice(peerId);
-			std::cerr << "Wrong value returned (1)" << std::endl;
-			exit(1);
+			int64_t sum = 0;
+			for(auto latency : _stepLatencies) sum += latency;
+			run.averageLatency = sum / (int64_t)_stepLatencies.size();
+			std::sort(_stepLatencies.begin(), _stepLatencies.end());
+			run.p95Latency = _stepLatencies.at(_stepLatencies.size() * 95 / 100);
 		}
-	// }}}
+		runs.push_back(run);
+
+		std::cout << "Faults sent:";
+		for(int32_t i = 0; i < (int32_t)FaultType::count; i++) std::cout << ' ' << _faultTypeNames[i] << ' ' << _faultsSent[i] << (i + 1 < (int32_t)FaultType::count ? "," : "");
+		std::cout << std::endl;
+	}
+	_faultRate = 0;
 
-	int32_t retries = 5;
-	for(int32_t i = 1023; i >= 0; i--)
+	std::cout << std::endl << "Fault rate | Faults | Steps | Retries | Steps/s | Avg. latency (ms) | P95 latency (ms)" << std::endl;
+	for(auto& run : runs)
 	{
-		if(retries != 5) i++;
-		sendPacket(std::vector<char>{ 0x55, 0x00, 0x0A, 0x07, 0x01, 0x00, (char)(uint8_t)0xA5, (char)(uint8_t)(i >> 8), (char)(uint8_t)(i & 0xFF), 0, 0x08, _byteAddress[0], _byteAddress[1], _byteAddress[2], _byteAddress[3], 0x00, 0x01, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, (char)(uint8_t)0xFF, 0x00, 0x00, 0x00 });
-		int32_t value = std::lround((getDoubleValue(peerId, 1, "PRESSURE") -500) * 1.573846);
-		if(value != i && value != i - 1  && value != i + 1)
+		std::cout << std::fixed << std::setprecision(2) << std::setw(10) << run.rate << " | " << std::setw(6) << run.faults << " | " << std::setw(5) << run.steps << " | " << std::setw(7) << run.retries << " | " << std::setw(7) << (run.duration > 0 ? (double)run.steps * 1000 / run.duration : 0) << " | " << std::setw(17) << run.averageLatency << " | " << std::setw(16) << run.p95Latency << std::endl;
+	}
+}
+
+/**
+ * Applies the conversions of Homegear's device descriptions to every raw value of every descriptor field and compares
+ * the results with the descriptor's formula. Nothing is sent, so the full value space of all EEPs is checked in
+ * seconds. Returns the number of fields with errors.
+ */
+int32_t testOracle(const std::string& directory)
+{
+	int64_t startTime = BaseLib::HelperFunctions::getTimeMicroseconds();
+	std::vector<XmlDevice> devices = loadDeviceDescriptions(directory, _indexFilename);
+	int64_t loadTime = BaseLib::HelperFunctions::getTimeMicroseconds() - startTime;
+	std::cout << "Loaded " << devices.size() << " device descriptions from " << directory << " in " << (loadTime / 1000) << " ms." << std::endl;
+
+	int32_t errors = 0;
+	int64_t checkedValues = 0;
+	std::vector<int32_t> raw;
+	std::vector<double> values;
+	raw.reserve(_oracleBatchSize);
+	startTime = BaseLib::HelperFunctions::getTimeMicroseconds();
+	for(auto& descriptor : getEepDescriptors())
+	{
+		auto deviceIterator = std::find_if(devices.begin(), devices.end(), [&](const XmlDevice& device) { return device.eep == descriptor.eep; });
+		if(deviceIterator == devices.end())
+		{
+			std::cout << descriptor.eep << ": No device description found." << std::endl;
+			errors++;
+			continue;
+		}
+
+		for(auto& field : descriptor.fields)
 		{
-			retries--;
-			if(retries > 0)
+			const XmlParameter* parameter = deviceIterator->getParameter(field.variable);
+			if(!parameter)
 			{
-				std::cout << 'r';
+				std::cout << descriptor.eep << " " << field.variable << ": Variable not found in " << deviceIterator->filename << "." << std::endl;
+				errors++;
 				continue;
 			}
-			std::cerr << "Wrong value returned for binary value " << i << ": " << value << std::endl;
-			deleteDevice(peerId);
-			exit(1);
+			if(parameter->bitOffset != field.bitOffset || parameter->bitSize != field.bitSize)
+			{
+				std::cout << descriptor.eep << " " << field.variable << ": Position is bit " << parameter->bitOffset << " size " << parameter->bitSize << ", expected bit " << field.bitOffset << " size " << field.bitSize << "." << std::endl;
+				errors++;
+			}
+
+			int32_t rawMin = field.threshold >= 0 ? 0 : field.rawMin;
+			int32_t rawMax = field.threshold >= 0 ? (1 << field.bitSize) - 1 : field.rawMax;
+			int64_t mismatches = 0;
+			for(int32_t batchStart = rawMin; batchStart <= rawMax; batchStart += _oracleBatchSize)
+			{
+				raw.clear();
+				for(int32_t i = batchStart; i <= rawMax && i < batchStart + _oracleBatchSize; i++) raw.push_back(i);
+				if(!convertFromPacket(*parameter, raw, values))
+				{
+					std::cout << descriptor.eep << " " << field.variable << ": Unsupported conversion in " << deviceIterator->filename << "." << std::endl;
+					mismatches = -1;
+					break;
+				}
+				checkedValues += raw.size();
+
+				for(size_t i = 0; i < raw.size(); i++)
+				{
+					bool valid = field.threshold >= 0 ? (values[i] != 0) == (raw[i] >= field.threshold) : std::abs(getFieldRaw(field, values[i]) - raw[i]) <= field.tolerance;
+					if(valid) continue;
+					if(mismatches < 5) std::cout << descriptor.eep << " " << field.variable << ": Raw value " << raw[i] << " is converted to " << values[i] << ", expected " << getFieldValue(field, raw[i]) << "." << std::endl;
+					mismatches++;
+				}
+			}
+			if(mismatches != 0) errors++;
+			if(mismatches > 5) std::cout << descriptor.eep << " " << field.variable << ": " << mismatches << " wrong values in total." << std::endl;
 		}
-		retries = 5;
-		std::cout << (i > 0 ? "." : ".; done.\n") << std::flush;
 	}
-	deleteDevice(peerId);
-}
+	int64_t checkTime = std::max((int64_t)1, BaseLib::HelperFunctions::getTimeMicroseconds() - startTime);
 
-void testF6()
-{
-	//testF60201();
-}
\ No newline at end of file
+	std::cout << "Checked " << checkedValues << " values in " << (checkTime / 1000) << " ms (" << (checkedValues * 1000000 / checkTime) << " values/s). ";
+	if(errors == 0) std::cout << "All conversions are correct." << std::endl;
+	else std::cout << errors << " fields with errors." << std::endl;
+	return errors;
+}
@@ -1,3 +1,4 @@
 #!/bin/bash
-g++ -std=c++11 -o homegear-enocean-tests $1 main.cpp -lhomegear-base -lgcrypt -lpthread -lgnutls
-g++ -std=c++11 -o sniff $1 sniff.cpp -lhomegear-base -lgcrypt -lpthread -lgnutls
+g++ -std=c++11 -o homegear-enocean-tests $1 main.cpp EepDescriptors.cpp DeviceDescriptions.cpp Trace.cpp Transport.cpp Metrics.cpp -lhomegear-base -lgcrypt -lpthread -lgnutls
+g++ -std=c++11 -o sniff $1 sniff.cpp EepDescriptors.cpp DeviceDescriptions.cpp Transport.cpp Metrics.cpp -lhomegear-base -lgcrypt -lpthread -lgnutls
+g++ -std=c++11 -o monitor $1 monitor.cpp Metrics.cpp
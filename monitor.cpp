@@ -0,0 +1,186 @@
+#include "Metrics.h"
+
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cerrno>
+#include <algorithm>
+#include <csignal>
+#include <unistd.h>
+
+/**
+ * Name without Prometheus labels.
+ */
+std::string getFamily(const std::string& name)
+{
+	return name.substr(0, name.find('{'));
+}
+
+/**
+ * Adds a label to a name that may already have labels.
+ */
+std::string addLabel(const std::string& name, const std::string& label)
+{
+	if(name.find('{') == std::string::npos) return name + '{' + label + '}';
+	return name.substr(0, name.size() - 1) + ',' + label + '}';
+}
+
+std::string escapeLabel(const std::string& value)
+{
+	std::string result;
+	for(char c : value)
+	{
+		if(c == '\\' || c == '"') result.push_back('\\');
+		if(c == '\n') result.append("\\n");
+		else result.push_back(c);
+	}
+	return result;
+}
+
+bool isRunning(const MetricsFile& file)
+{
+	return kill(file.pid, 0) == 0 || errno == EPERM;
+}
+
+/**
+ * Prometheus text exposition format, e. g. for the textfile collector of node_exporter or a scrape through inetd.
+ */
+void printPrometheus(const MetricsFile& file)
+{
+	std::ostringstream output;
+	output << "# HELP metrics_process_running 1 while the process writing the metrics file runs." << std::endl;
+	output << "# TYPE metrics_process_running gauge" << std::endl;
+	output << "metrics_process_running{program=\"" << escapeLabel(file.program) << "\",pid=\"" << file.pid << "\"} " << (isRunning(file) ? 1 : 0) << std::endl;
+
+	std::string lastFamily;
+	uint32_t count = std::min(file.count.load(std::memory_order_acquire), metricsCapacity);
+	for(uint32_t i = 0; i < count; i++)
+	{
+		const MetricSlot& slot = file.slots[i];
+		std::string name(slot.name);
+		std::string family = getFamily(name);
+		if(family != lastFamily)
+		{
+			const char* type = slot.type == MetricType::counter ? "counter" : (slot.type == MetricType::histogram ? "histogram" : "gauge");
+			output << "# HELP " << family << ' ' << slot.help << std::endl;
+			output << "# TYPE " << family << ' ' << type << std::endl;
+			lastFamily = family;
+		}
+
+		if(slot.type == MetricType::histogram)
+		{
+			std::string labels = name.substr(family.size());
+			int64_t cumulative = 0;
+			for(uint32_t bucket = 0; bucket < metricsBuckets - 1; bucket++)
+			{
+				cumulative += slot.values[bucket + 2].load(std::memory_order_relaxed);
+				output << addLabel(family + "_bucket" + labels, "le=\"" + std::to_string(((int64_t)1 << bucket) - 1) + "\"") << ' ' << cumulative << std::endl;
+			}
+			int64_t histogramCount = slot.values[0].load(std::memory_order_relaxed);
+			output << addLabel(family + "_bucket" + labels, "le=\"+Inf\"") << ' ' << histogramCount << std::endl;
+			output << family << "_sum" << labels << ' ' << slot.values[1].load(std::memory_order_relaxed) << std::endl;
+			output << family << "_count" << labels << ' ' << histogramCount << std::endl;
+		}
+		else if(slot.type == MetricType::text) output << addLabel(name, "value=\"" + escapeLabel(getMetricsText(slot)) + "\"") << " 1" << std::endl;
+		else output << name << ' ' << slot.values[0].load(std::memory_order_relaxed) << std::endl;
+	}
+	std::cout << output.str() << std::flush;
+}
+
+/**
+ * Prints all metrics. Counters are followed by their rate since the previous call.
+ */
+void printTable(const MetricsFile& file, std::map<std::string, int64_t>& lastValues, double seconds)
+{
+	std::ostringstream output;
+	int64_t uptime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() - file.startTime;
+	output << file.program << " (PID " << file.pid << ", " << (isRunning(file) ? "running" : "not running") << ", started " << uptime / 1000 << " s ago)" << std::endl;
+
+	uint32_t count = std::min(file.count.load(std::memory_order_acquire), metricsCapacity);
+	for(uint32_t i = 0; i < count; i++)
+	{
+		const MetricSlot& slot = file.slots[i];
+		std::string name(slot.name);
+		output << "  " << std::setw(60) << std::left << name << std::right << ' ';
+		if(slot.type == MetricType::text) output << getMetricsText(slot);
+		else if(slot.type == MetricType::histogram)
+		{
+			output << std::fixed << std::setprecision(1) << slot.values[0].load(std::memory_order_relaxed) << " values, P50 " << getMetricsQuantile(slot, 0.5) / 1000 << " ms, P90 " << getMetricsQuantile(slot, 0.9) / 1000 << " ms, P99 " << getMetricsQuantile(slot, 0.99) / 1000 << " ms";
+		}
+		else
+		{
+			int64_t value = slot.values[0].load(std::memory_order_relaxed);
+			output << value;
+			if(slot.type == MetricType::counter)
+			{
+				auto lastValue = lastValues.find(name);
+				if(lastValue != lastValues.end() && seconds > 0) output << " (" << std::fixed << std::setprecision(1) << (value - lastValue->second) / seconds << "/s)";
+				lastValues[name] = value;
+			}
+		}
+		output << std::endl;
+	}
+	std::cout << output.str() << std::flush;
+}
+
+void printHelp()
+{
+	std::cout << "Usage: monitor FILE [OPTIONS]" << std::endl;
+	std::cout << "  FILE:                 Metrics file written by homegear-enocean-tests or sniff with \"--metrics FILE\"" << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << "  --prometheus:         Print the metrics once in the Prometheus text format" << std::endl;
+	std::cout << "  --interval SECONDS:   Print the metrics every SECONDS seconds with the rates of all counters (default: once)" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string filename;
+	bool prometheus = false;
+	double interval = 0;
+	for(int32_t i = 1; i < argc; i++)
+	{
+		std::string argument(argv[i]);
+		if(argument == "--prometheus") prometheus = true;
+		else if(argument == "--interval" && i + 1 < argc) interval = std::strtod(argv[++i], nullptr);
+		else if(filename.empty() && argument.compare(0, 2, "--") != 0) filename = argument;
+		else
+		{
+			printHelp();
+			exit(1);
+		}
+	}
+	if(filename.empty())
+	{
+		printHelp();
+		exit(1);
+	}
+
+	const MetricsFile* file = openMetrics(filename);
+	if(!file)
+	{
+		std::cerr << "Could not open metrics file " << filename << "." << std::endl;
+		exit(1);
+	}
+
+	if(prometheus)
+	{
+		printPrometheus(*file);
+		return 0;
+	}
+
+	std::map<std::string, int64_t> lastValues;
+	printTable(*file, lastValues, 0);
+	while(interval > 0)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds((int64_t)(interval * 1000)));
+		std::cout << std::endl;
+		printTable(*file, lastValues, interval);
+	}
+	return 0;
+}
@@ -1,45 +1,682 @@
 #include <homegear-base/BaseLib.h>
+#include "EepDescriptors.h"
+#include "DeviceDescriptions.h"
+#include "Transport.h"
+#include "Metrics.h"
 #include <string>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
 #include <vector>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <csignal>
+#include <poll.h>
 
-int main(int argc, char* argv[])
+/**
+ * Decoder of one value, precomputed so that decoding a frame only needs a shift, a mask and a multiply-add per value.
+ */
+struct DecodeField
 {
-	std::unique_ptr<BaseLib::SharedObjects> bl(new BaseLib::SharedObjects(std::string(""), nullptr, false));
-	BaseLib::SerialReaderWriter serial(bl.get(), "/dev/ttyUSB0", 57600, 0, true, -1);
-	serial.openDevice(false, false, false);
+	std::string variable;
+	std::string unit;
+	uint32_t shift = 0; // Right shift of the first 8 data bytes read as big endian integer
+	uint64_t mask = 0;
+	double scale = 1;
+	double base = 0;
+	int32_t threshold = -1; // Boolean values are true from this raw value on, -1 for numeric values
+	bool invert = false;
+};
+
+struct DecodeKernel
+{
+	std::string eep;
+	uint8_t rorg = 0;
+	std::vector<DecodeField> fields;
+};
+
+/**
+ * Maps sender IDs to decode kernels. Open addressing with linear probing over flat arrays, so a lookup usually touches
+ * a single cache line. Sender ID 0 is not valid on air and marks empty slots.
+ */
+class SenderTable
+{
+public:
+	SenderTable() : _bits(6), _keys(1 << 6, 0), _values(1 << 6, -1) {}
+
+	int32_t get(uint32_t sender) const
+	{
+		size_t slot = getSlot(sender);
+		return _keys[slot] == sender ? _values[slot] : -1;
+	}
+
+	void set(uint32_t sender, int32_t kernel)
+	{
+		if(sender == 0) return;
+		if((_size + 1) * 2 > _keys.size()) grow();
+		size_t slot = getSlot(sender);
+		if(_keys[slot] != sender) _size++;
+		_keys[slot] = sender;
+		_values[slot] = kernel;
+	}
+private:
+	uint32_t _bits;
+	size_t _size = 0;
+	std::vector<uint32_t> _keys;
+	std::vector<int32_t> _values;
+
+	size_t getSlot(uint32_t sender) const
+	{
+		size_t mask = _keys.size() - 1;
+		size_t slot = (uint32_t)(sender * 2654435761u) >> (32 - _bits);
+		while(_keys[slot] != 0 && _keys[slot] != sender) slot = (slot + 1) & mask;
+		return slot;
+	}
+
+	void grow()
+	{
+		std::vector<uint32_t> keys;
+		std::vector<int32_t> values;
+		keys.swap(_keys);
+		values.swap(_values);
+		_bits++;
+		_keys.resize(1 << _bits, 0);
+		_values.resize(1 << _bits, -1);
+		_size = 0;
+		for(size_t i = 0; i < keys.size(); i++)
+		{
+			if(keys[i] != 0) set(keys[i], values[i]);
+		}
+	}
+};
+
+std::vector<DecodeKernel> _kernels;
+std::map<std::string, int32_t> _kernelIndexes;
+SenderTable _senders;
+std::string _profileFilename;
 
-	int32_t size = 0;
-	std::vector<char> dataArray;
+/**
+ * A complete ESP3 packet as read by one receiver.
+ */
+struct ReceivedPacket
+{
+	size_t receiver;
+	int64_t time; // Microseconds as returned by getTimeMicroseconds()
+	std::vector<uint8_t> packet;
+};
+
+/**
+ * Receptions of the same telegram by several receivers, collapsed into one.
+ */
+struct MergedPacket
+{
+	int64_t time = 0; // Of the first reception
+	int32_t rssi = 0; // Best RSSI in dBm, 0 for packets without RSSI
+	std::vector<uint8_t> packet; // The reception with the best RSSI
+	std::map<size_t, int32_t> receivers; // Best RSSI by receiver
+};
+
+/**
+ * How well one receiver hears one sender.
+ */
+struct Coverage
+{
+	int64_t telegrams = 0;
+	int32_t bestRssi = 0;
+	int64_t rssiSum = 0;
+};
+
+std::vector<std::string> _receivers;
+std::mutex _receivedMutex;
+std::condition_variable _receivedConditionVariable;
+std::vector<ReceivedPacket> _received; // Filled by the reader threads, taken by the merge stage
+int64_t _mergeWindow = 100000; // Microseconds receptions of one telegram may be apart
+std::map<uint32_t, std::vector<Coverage>> _coverage; // By sender, one entry per receiver
+volatile std::sig_atomic_t _terminate = 0;
+
+/**
+ * Live metrics of the session, see "--metrics" and monitor.cpp.
+ */
+struct SniffMetrics
+{
+	SniffMetrics();
+
+	std::atomic<int64_t>& telegrams;
+	std::atomic<int64_t>& duplicates;
+	std::atomic<int64_t>& pending;
+	std::atomic<int64_t>& senders;
+	MetricsText& lastTelegram;
+	std::vector<std::atomic<int64_t>*> packetsReceived; // By receiver
+	std::vector<std::atomic<int64_t>*> rssi; // Of the last telegram by receiver
+};
+std::unique_ptr<SniffMetrics> _metrics;
+
+SniffMetrics::SniffMetrics() :
+	telegrams(addCounter("enocean_sniff_telegrams_total", "Radio telegrams after merging the receptions of all gateways.")),
+	duplicates(addCounter("enocean_sniff_duplicates_total", "Receptions merged into a telegram already received by another gateway.")),
+	pending(addGauge("enocean_sniff_pending_telegrams", "Telegrams waiting for receptions by other gateways.")),
+	senders(addGauge("enocean_sniff_senders", "Different senders heard.")),
+	lastTelegram(addText("enocean_sniff_last_telegram", "The last decoded telegram."))
+{
+	for(size_t i = 0; i < _receivers.size(); i++)
+	{
+		std::string label = "{receiver=\"R" + std::to_string(i + 1) + "\"}";
+		packetsReceived.push_back(&addCounter("enocean_sniff_packets_received_total" + label, "ESP3 packets read from the gateway."));
+	}
+	for(size_t i = 0; i < _receivers.size(); i++) rssi.push_back(&addGauge("enocean_sniff_rssi_dbm{receiver=\"R" + std::to_string(i + 1) + "\"}", "RSSI of the last telegram received by the gateway."));
+}
+
+std::string getUnit(const std::string& variable)
+{
+	if(variable.compare(0, 11, "TEMPERATURE") == 0) return "°C";
+	if(variable.compare(0, 8, "HUMIDITY") == 0) return "%";
+	if(variable.compare(0, 12, "ILLUMINATION") == 0) return "lx";
+	if(variable.compare(0, 8, "PRESSURE") == 0) return "hPa";
+	if(variable == "SUPPLY_VOLTAGE" || variable == "ENERGY_STORAGE") return "V";
+	return "";
+}
+
+bool getDecodeField(const std::string& variable, int32_t bitOffset, int32_t bitSize, DecodeField& field)
+{
+	if(bitOffset < 0 || bitSize <= 0 || bitSize > 32 || bitOffset + bitSize > 64) return false;
+	field.variable = variable;
+	field.unit = getUnit(variable);
+	field.shift = 64 - bitOffset - bitSize;
+	field.mask = (1ull << bitSize) - 1;
+	return true;
+}
+
+DecodeKernel getKernel(const EepDescriptor& descriptor)
+{
+	DecodeKernel kernel;
+	kernel.eep = descriptor.eep;
+	kernel.rorg = descriptor.rorg;
+	for(auto& field : descriptor.fields)
+	{
+		DecodeField decodeField;
+		if(!getDecodeField(field.variable, field.bitOffset, field.bitSize, decodeField)) continue;
+		decodeField.scale = 1.0 / field.factor;
+		decodeField.base = field.base;
+		decodeField.threshold = field.threshold;
+		kernel.fields.push_back(decodeField);
+	}
+	return kernel;
+}
+
+/**
+ * Only linear conversion chains and boolean thresholds can be folded into a kernel. Other variables are left out.
+ */
+DecodeKernel getKernel(const XmlDevice& device)
+{
+	DecodeKernel kernel;
+	kernel.eep = device.eep;
+	kernel.rorg = BaseLib::Math::getNumber(device.eep.substr(0, 2), true);
+	for(auto& parameter : device.parameters)
+	{
+		DecodeField field;
+		if(!getDecodeField(parameter.id, parameter.bitOffset, parameter.bitSize, field)) continue;
+		bool supported = true;
+		for(auto conversion = parameter.conversions.rbegin(); conversion != parameter.conversions.rend() && supported; ++conversion)
+		{
+			if(conversion->type == XmlConversion::Type::decimalIntegerScale && field.threshold == -1)
+			{
+				field.scale /= conversion->factor;
+				field.base = field.base / conversion->factor - conversion->offset;
+			}
+			else if(conversion->type == XmlConversion::Type::integerIntegerScale && field.threshold == -1)
+			{
+				double factor = conversion->division ? conversion->factor : 1.0 / conversion->factor;
+				field.base = (field.base - conversion->offset) * factor;
+				field.scale *= factor;
+			}
+			else if(conversion->type == XmlConversion::Type::booleanInteger && conversion->threshold >= 0 && field.scale == 1 && field.base == 0)
+			{
+				field.threshold = conversion->threshold;
+				field.invert = conversion->invert;
+			}
+			else supported = false;
+		}
+		if(!supported) continue;
+		if(parameter.boolean && field.threshold == -1) field.threshold = 1;
+		kernel.fields.push_back(field);
+	}
+	return kernel;
+}
+
+int32_t getKernelIndex(const std::string& eep)
+{
+	auto kernelIterator = _kernelIndexes.find(eep);
+	if(kernelIterator != _kernelIndexes.end()) return kernelIterator->second;
+
+	// Unknown EEPs still get an empty kernel so the EEP is printed.
+	DecodeKernel kernel;
+	kernel.eep = eep;
+	kernel.rorg = BaseLib::Math::getNumber(eep.substr(0, 2), true);
+	_kernels.push_back(kernel);
+	_kernelIndexes[eep] = _kernels.size() - 1;
+	return _kernels.size() - 1;
+}
+
+void createKernels(const std::string& descriptionDirectory, const std::string& indexFilename)
+{
+	// The hand-maintained descriptors come first, so they win over device descriptions for the same EEP.
+	for(auto& descriptor : getEepDescriptors())
+	{
+		_kernels.push_back(getKernel(descriptor));
+		_kernelIndexes[descriptor.eep] = _kernels.size() - 1;
+	}
+
+	if(descriptionDirectory.empty()) return;
+	for(auto& device : loadDeviceDescriptions(descriptionDirectory, indexFilename))
+	{
+		if(_kernelIndexes.find(device.eep) != _kernelIndexes.end()) continue;
+		_kernels.push_back(getKernel(device));
+		_kernelIndexes[device.eep] = _kernels.size() - 1;
+	}
+}
+
+/**
+ * Reads lines of the form "SENDERID EEP" (e.g. "0185A2F3 A50201"). Empty lines and lines starting with "#" are
+ * ignored.
+ */
+void loadProfiles(const std::string& filename)
+{
+	std::ifstream file(filename);
+	std::string line;
+	int32_t count = 0;
+	while(std::getline(file, line))
+	{
+		std::istringstream stream(line);
+		std::string sender;
+		std::string eep;
+		if(!(stream >> sender >> eep) || sender.at(0) == '#') continue;
+		_senders.set(BaseLib::Math::getNumber(sender, true), getKernelIndex(BaseLib::HelperFunctions::toUpper(eep)));
+		count++;
+	}
+	std::cout << "Loaded " << count << " sender profiles from " << filename << "." << std::endl;
+}
+
+void learnProfile(uint32_t sender, const std::string& eep)
+{
+	int32_t kernelIndex = getKernelIndex(eep);
+	if(_senders.get(sender) == kernelIndex) return;
+	_senders.set(sender, kernelIndex);
+	std::cout << "Learned EEP " << eep << " for sender " << BaseLib::HelperFunctions::getHexString((int32_t)sender, 8) << "." << std::endl;
+	if(_profileFilename.empty()) return;
+	std::ofstream file(_profileFilename, std::ios::app);
+	file << BaseLib::HelperFunctions::getHexString((int32_t)sender, 8) << ' ' << eep << std::endl;
+}
+
+std::string getEep(uint8_t rorg, uint8_t func, uint8_t type)
+{
+	return BaseLib::HelperFunctions::getHexString((int32_t)((rorg << 16) | (func << 8) | type), 6);
+}
+
+/**
+ * Decodes an ERP1 radio packet. Teach-in telegrams update the sender table, all other telegrams are decoded with the
+ * sender's kernel or, for senders without profile, only the generic RPS and 1BS information is printed.
+ */
+std::string decodePacket(const std::vector<uint8_t>& packet)
+{
+	if(packet.size() < 7 || packet[4] != 1) return "";
+	uint32_t dataSize = (packet[1] << 8) | packet[2];
+	uint32_t optionalSize = packet[3];
+	if(dataSize < 6 || packet.size() < 6 + dataSize + optionalSize + 1) return "";
+	const uint8_t* data = packet.data() + 6;
+	uint8_t rorg = data[0];
+	uint32_t userDataSize = dataSize - 6;
+	uint32_t sender = ((uint32_t)data[dataSize - 5] << 24) | (data[dataSize - 4] << 16) | (data[dataSize - 3] << 8) | data[dataSize - 2];
+
+	std::ostringstream output;
+	output << "  " << BaseLib::HelperFunctions::getHexString((int32_t)sender, 8);
+	if(optionalSize >= 6) output << " (-" << (int32_t)data[dataSize + 5] << " dBm)";
+
+	// {{{ Teach-in
+		if(rorg == 0xA5 && userDataSize == 4 && !(data[4] & 0x08))
+		{
+			if(data[4] & 0x80) learnProfile(sender, getEep(0xA5, data[1] >> 2, ((data[1] & 0x03) << 5) | (data[2] >> 3)));
+			output << " 4BS teach-in";
+			return output.str();
+		}
+		else if(rorg == 0xD4 && userDataSize >= 7)
+		{
+			learnProfile(sender, getEep(data[7], data[6], data[5]));
+			output << " UTE teach-in";
+			return output.str();
+		}
+		else if(rorg == 0xD5 && userDataSize == 1 && !(data[1] & 0x08))
+		{
+			learnProfile(sender, "D50001");
+			output << " 1BS teach-in";
+			return output.str();
+		}
+	// }}}
+
+	uint64_t word = 0;
+	for(uint32_t i = 0; i < 8; i++) word = (word << 8) | (i < userDataSize ? data[1 + i] : 0);
+
+	int32_t kernelIndex = _senders.get(sender);
+	const DecodeKernel* kernel = kernelIndex >= 0 ? &_kernels[kernelIndex] : nullptr;
+	if(kernel && kernel->rorg == rorg)
+	{
+		output << ' ' << kernel->eep;
+		for(auto& field : kernel->fields)
+		{
+			uint64_t raw = (word >> field.shift) & field.mask;
+			output << ' ' << field.variable << '=';
+			if(field.threshold >= 0) output << (((int64_t)raw >= field.threshold) != field.invert ? "true" : "false");
+			else output << std::fixed << std::setprecision(2) << (field.base + raw * field.scale) << field.unit;
+		}
+		if(kernel->fields.empty()) output << " (no decoder)";
+	}
+	else if(rorg == 0xF6 && userDataSize >= 1)
+	{
+		uint8_t status = data[dataSize - 1];
+		output << " RPS " << ((status & 0x20) ? "T21 " : "") << "BUTTON=0x" << BaseLib::HelperFunctions::getHexString((int32_t)data[1], 2) << ((data[1] & 0x10) ? " pressed" : " released");
+	}
+	else if(rorg == 0xD5 && userDataSize == 1)
+	{
+		output << " 1BS CONTACT=" << ((data[1] & 0x01) ? "closed" : "open");
+	}
+	else output << " RORG " << BaseLib::HelperFunctions::getHexString((int32_t)rorg, 2) << " (no profile)";
+	return output.str();
+}
+
+/**
+ * Reader thread of one receiver. Packets are collected per read() and handed to the merge stage in one batch, so the
+ * lock is taken once per read and not once per packet.
+ */
+void readPackets(size_t receiver, Transport* transport)
+{
+	uint32_t size = 0;
+	std::vector<uint8_t> dataArray;
+	std::vector<ReceivedPacket> packets;
 	while(true)
 	{
-		char data;
-		int32_t result = serial.readChar(data, 5000000);
-		if(result == -1)
+		pollfd pollInfo{ transport->fileDescriptor(), POLLIN, 0 };
+		int32_t result = poll(&pollInfo, 1, 5000);
+		if(result == -1 && errno == EINTR) continue;
+		else if(result == -1)
 		{
-			std::cerr << "Error" << std::endl;
-			return -1;
+			std::cerr << "Error reading from " << _receivers.at(receiver) << std::endl;
+			return;
 		}
-		else if(result == 1)
+		else if(result == 0)
 		{
 			size = 0;
 			dataArray.clear();
 			continue;
 		}
 
-		if(dataArray.empty() && data != 0x55) continue;
+		char buffer[1024];
+		ssize_t bytesRead = transport->read(buffer, sizeof(buffer));
+		if(bytesRead < 0)
+		{
+			std::cerr << "Error reading from " << _receivers.at(receiver) << std::endl;
+			return;
+		}
+
+		int64_t time = BaseLib::HelperFunctions::getTimeMicroseconds();
+		for(ssize_t i = 0; i < bytesRead; i++)
+		{
+			char data = buffer[i];
+			if(dataArray.empty() && data != 0x55) continue;
 
-		dataArray.push_back(data);
-		if(size == 0 && dataArray.size() == 6) size = ((dataArray[1] << 8) | dataArray[2]) + dataArray[3] + 7;
-		if(size > 0 && dataArray.size() == size)
+			dataArray.push_back(data);
+			if(size == 0 && dataArray.size() == 6) size = ((dataArray[1] << 8) | dataArray[2]) + dataArray[3] + 7;
+			if(size > 0 && dataArray.size() == size)
+			{
+				size = 0;
+				packets.push_back(ReceivedPacket{ receiver, time, std::vector<uint8_t>() });
+				packets.back().packet.swap(dataArray);
+			}
+		}
+
+		if(packets.empty()) continue;
+		_metrics->packetsReceived.at(receiver)->fetch_add(packets.size(), std::memory_order_relaxed);
 		{
-			size = 0;
-			std::cout << BaseLib::HelperFunctions::getHexString(dataArray) << std::endl;
-			dataArray.clear();
+			std::lock_guard<std::mutex> receivedGuard(_receivedMutex);
+			_received.insert(_received.end(), std::make_move_iterator(packets.begin()), std::make_move_iterator(packets.end()));
+		}
+		_receivedConditionVariable.notify_one();
+		packets.clear();
+	}
+}
+
+/**
+ * Radio telegrams are identified by their data, which includes sender ID and status. Other packets are answers of the
+ * receiver itself and never merged with those of other receivers.
+ */
+std::string getPacketKey(const ReceivedPacket& received)
+{
+	const std::vector<uint8_t>& packet = received.packet;
+	uint32_t dataSize = (packet[1] << 8) | packet[2];
+	if(packet[4] == 1 && packet.size() >= 6 + dataSize) return std::string(1, 'R') + std::string(packet.begin() + 6, packet.begin() + 6 + dataSize);
+	return std::string(1, 'L') + std::to_string(received.receiver) + ' ' + std::string(packet.begin(), packet.end());
+}
+
+int32_t getRssi(const std::vector<uint8_t>& packet)
+{
+	uint32_t dataSize = (packet[1] << 8) | packet[2];
+	if(packet[4] != 1 || packet[3] < 6 || packet.size() < 6 + dataSize + 6) return 0;
+	return -(int32_t)packet[6 + dataSize + 5];
+}
+
+void printPacket(const MergedPacket& merged)
+{
+	std::cout << BaseLib::HelperFunctions::getHexString(merged.packet) << std::endl;
+	std::string decoded = decodePacket(merged.packet);
+	if(decoded.empty()) return;
+	_metrics->telegrams.fetch_add(1, std::memory_order_relaxed);
+	if(isMetricsEnabled()) _metrics->lastTelegram.set(decoded);
+	std::cout << decoded;
+	if(_receivers.size() > 1)
+	{
+		std::cout << " [";
+		for(auto receiver = merged.receivers.begin(); receiver != merged.receivers.end(); ++receiver)
+		{
+			std::cout << (receiver == merged.receivers.begin() ? "" : ", ") << 'R' << (receiver->first + 1);
+			if(receiver->second != 0) std::cout << ' ' << receiver->second << " dBm";
+		}
+		std::cout << ']';
+	}
+	std::cout << std::endl;
+
+	uint32_t dataSize = (merged.packet[1] << 8) | merged.packet[2];
+	if(merged.packet[4] != 1 || dataSize < 6) return;
+	const uint8_t* data = merged.packet.data() + 6;
+	uint32_t sender = ((uint32_t)data[dataSize - 5] << 24) | (data[dataSize - 4] << 16) | (data[dataSize - 3] << 8) | data[dataSize - 2];
+	std::vector<Coverage>& coverage = _coverage[sender];
+	_metrics->senders.store(_coverage.size(), std::memory_order_relaxed);
+	coverage.resize(_receivers.size());
+	for(auto& receiver : merged.receivers)
+	{
+		Coverage& receiverCoverage = coverage.at(receiver.first);
+		if(receiverCoverage.telegrams == 0 || receiver.second > receiverCoverage.bestRssi) receiverCoverage.bestRssi = receiver.second;
+		receiverCoverage.telegrams++;
+		receiverCoverage.rssiSum += receiver.second;
+		_metrics->rssi.at(receiver.first)->store(receiver.second, std::memory_order_relaxed);
+	}
+}
+
+/**
+ * Per sender and receiver: Telegrams heard, average and best RSSI. Senders heard by a single receiver only are marked,
+ * they are lost when that receiver fails.
+ */
+void printCoverage()
+{
+	std::cout << std::endl << "Coverage (telegrams, average / best RSSI in dBm):" << std::endl;
+	for(size_t i = 0; i < _receivers.size(); i++) std::cout << "  R" << (i + 1) << ": " << _receivers[i] << std::endl;
+	std::cout << "Sender   | EEP   ";
+	for(size_t i = 0; i < _receivers.size(); i++) std::cout << " | R" << std::setw(18) << std::left << (i + 1) << std::right;
+	std::cout << std::endl;
+	for(auto& sender : _coverage)
+	{
+		int32_t kernelIndex = _senders.get(sender.first);
+		int32_t receiverCount = 0;
+		std::cout << BaseLib::HelperFunctions::getHexString((int32_t)sender.first, 8) << " | " << std::setw(6) << std::left << (kernelIndex >= 0 ? _kernels[kernelIndex].eep : "") << std::right;
+		for(auto& coverage : sender.second)
+		{
+			std::cout << " | ";
+			if(coverage.telegrams == 0)
+			{
+				std::cout << std::setw(19) << "-";
+				continue;
+			}
+			receiverCount++;
+			std::ostringstream cell;
+			cell << coverage.telegrams << ", " << (coverage.rssiSum / coverage.telegrams) << " / " << coverage.bestRssi;
+			std::cout << std::setw(19) << cell.str();
+		}
+		if(receiverCount == 1 && _receivers.size() > 1) std::cout << " (single receiver)";
+		std::cout << std::endl;
+	}
+}
+
+void handleSignal(int signalNumber)
+{
+	_terminate = signalNumber; // The merge loop wakes at least every half merge window and checks this
+}
+
+void printHelp()
+{
+	std::cout << "Usage: sniff [GATEWAY...] [OPTIONS]" << std::endl;
+	std::cout << "  GATEWAY:                  A USB 300: A serial device (default: \"/dev/ttyUSB0\"), \"tcp://HOST:PORT[?nodelay=0]\" or \"loopback[:PORT]\". With several gateways the telegrams of all of them are merged and a coverage map is printed on Ctrl-C." << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << "  --profiles FILE:          Sender to EEP mappings, one \"SENDERID EEP\" per line. Mappings learned from teach-in telegrams are appended." << std::endl;
+	std::cout << "  --descriptions DIRECTORY: Also create decoders from Homegear's device descriptions (Example: \"/etc/homegear/devices/15\")" << std::endl;
+	std::cout << "  --merge-window MS:        Receptions of the same telegram by different gateways this far apart are merged (default: 100)" << std::endl;
+	std::cout << "  --metrics FILE:           Publish live counters (packets per gateway, telegrams, senders, last telegram) to FILE. Read them with \"monitor FILE\"." << std::endl;
+	std::cout << "  --index FILE:             Binary index of the device descriptions (default: \"/var/tmp/homegear-enocean-tests.index\")" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string descriptionDirectory;
+	std::string indexFilename("/var/tmp/homegear-enocean-tests.index");
+	std::string metricsFilename;
+	for(int32_t i = 1; i < argc; i++)
+	{
+		std::string argument(argv[i]);
+		if(argument == "--profiles" && i + 1 < argc) _profileFilename = std::string(argv[++i]);
+		else if(argument == "--descriptions" && i + 1 < argc) descriptionDirectory = std::string(argv[++i]);
+		else if(argument == "--index" && i + 1 < argc) indexFilename = std::string(argv[++i]);
+		else if(argument == "--metrics" && i + 1 < argc) metricsFilename = std::string(argv[++i]);
+		else if(argument == "--merge-window" && i + 1 < argc) _mergeWindow = BaseLib::Math::getNumber(std::string(argv[++i])) * 1000;
+		else if(isTransportAddress(argument)) _receivers.push_back(argument);
+		else
+		{
+			printHelp();
+			exit(1);
+		}
+	}
+	if(_receivers.empty()) _receivers.push_back("/dev/ttyUSB0");
+	if(!metricsFilename.empty()) startMetrics(metricsFilename, "sniff");
+	_metrics.reset(new SniffMetrics());
+
+	createKernels(descriptionDirectory, indexFilename);
+	if(!_profileFilename.empty()) loadProfiles(_profileFilename);
+
+	std::unique_ptr<BaseLib::SharedObjects> bl(new BaseLib::SharedObjects(std::string(""), nullptr, false));
+	std::vector<std::unique_ptr<Transport>> transports;
+	for(auto& receiver : _receivers)
+	{
+		try
+		{
+			transports.push_back(createTransport(receiver, bl.get()));
+			transports.back()->open();
+		}
+		catch(BaseLib::Exception& ex)
+		{
+			std::cerr << ex.what() << std::endl;
+			exit(1);
 		}
 	}
 
-	serial.closeDevice();
+	struct sigaction signalAction{};
+	signalAction.sa_handler = handleSignal;
+	sigemptyset(&signalAction.sa_mask);
+	sigaction(SIGINT, &signalAction, nullptr);
+	sigaction(SIGTERM, &signalAction, nullptr);
+
+	for(size_t i = 0; i < transports.size(); i++) std::thread(readPackets, i, transports[i].get()).detach();
+
+	// {{{ Merge stage: Receptions wait _mergeWindow for duplicates from other receivers, then leave in time order
+		std::unordered_map<std::string, MergedPacket> pending;
+		std::multimap<int64_t, std::string> order;
+		std::vector<ReceivedPacket> received;
+		while(true)
+		{
+			{
+				std::unique_lock<std::mutex> receivedGuard(_receivedMutex);
+				_receivedConditionVariable.wait_for(receivedGuard, std::chrono::microseconds(_mergeWindow / 2 + 1), []() { return !_received.empty() || _terminate != 0; });
+				received.swap(_received);
+			}
+
+			for(auto& reception : received)
+			{
+				std::string key = getPacketKey(reception);
+				int32_t rssi = getRssi(reception.packet);
+				auto pendingIterator = pending.find(key);
+				if(pendingIterator == pending.end())
+				{
+					MergedPacket& merged = pending[key];
+					merged.time = reception.time;
+					merged.rssi = rssi;
+					merged.packet.swap(reception.packet);
+					merged.receivers[reception.receiver] = rssi;
+					order.insert(std::make_pair(reception.time, key));
+					continue;
+				}
+
+				MergedPacket& merged = pendingIterator->second;
+				_metrics->duplicates.fetch_add(1, std::memory_order_relaxed);
+				if(reception.time < merged.time)
+				{
+					// A reader was late, move the telegram to its earlier reception time
+					for(auto orderIterator = order.find(merged.time); orderIterator != order.end() && orderIterator->first == merged.time; ++orderIterator)
+					{
+						if(orderIterator->second != key) continue;
+						order.erase(orderIterator);
+						break;
+					}
+					merged.time = reception.time;
+					order.insert(std::make_pair(reception.time, key));
+				}
+				auto receiverIterator = merged.receivers.find(reception.receiver);
+				if(receiverIterator == merged.receivers.end()) merged.receivers[reception.receiver] = rssi;
+				else receiverIterator->second = std::max(receiverIterator->second, rssi);
+				if(rssi > merged.rssi)
+				{
+					merged.rssi = rssi;
+					merged.packet.swap(reception.packet);
+				}
+			}
+			received.clear();
+
+			int64_t now = BaseLib::HelperFunctions::getTimeMicroseconds();
+			while(!order.empty() && (order.begin()->first + _mergeWindow <= now || _terminate != 0))
+			{
+				auto pendingIterator = pending.find(order.begin()->second);
+				printPacket(pendingIterator->second);
+				pending.erase(pendingIterator);
+				order.erase(order.begin());
+			}
+			_metrics->pending.store(pending.size(), std::memory_order_relaxed);
+
+			if(_terminate != 0)
+			{
+				if(_receivers.size() > 1) printCoverage();
+				std::cout << std::flush;
+				_exit(0); // The reader threads block in poll() and are not joined
+			}
+		}
+	// }}}
 
 	return 0;
 }